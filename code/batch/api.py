@@ -1,8 +1,10 @@
 #!/usr/bin/env python
 from __future__ import print_function, division
+import ctypes
 import json
 import os
 import re
+import results
 import svgwrite
 import sys
 import time
@@ -233,14 +235,25 @@ class ProblemParser:
 
 
 class Solution:
-  def __init__(self, spec):
+  def __init__(self, spec=None):
     self.spec = spec
+    if spec is None:
+      return
     p = SolutionParser(spec)
     self.vertices = p.parse_poly()
     self.facet_lines = p.save_n_lines()
     self.facets = p.parse_facets(self.vertices, self.facet_lines)
     self.destination = p.parse_poly(n=len(self.vertices))
 
+  @staticmethod
+  def from_arrays(vertices, facets, destination):
+    res = Solution()
+    res.vertices = vertices
+    res.facet_lines = [' '.join(str(x) for x in [len(f)] + f) for f in facets]
+    res.facets = [[vertices[x] for x in f] for f in facets]
+    res.destination = destination
+    return res
+
   def to_str(self):
     def frac(p):
       if isinstance(p, float):
@@ -303,13 +316,87 @@ class SolutionParser(ProblemParser):
 
 
 
+class SolverOptions(ctypes.Structure):
+  _fields_ = [('numeric', ctypes.c_uint32), ('time_limit', ctypes.c_double)]
+
+class LibSolver:
+  # the solver core in process, through the C interface of libsolver
+
+  abi_version = 2
+  default_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '../build/release/libsolver.so')
+
+  def __init__(self, path=None, patterns=None, forward_depth=0):
+    lib = ctypes.CDLL(path or os.environ.get('LIBSOLVER', self.default_path))
+    p = ctypes.c_void_p
+    dp = ctypes.POINTER(ctypes.POINTER(ctypes.c_double))
+    up = ctypes.POINTER(ctypes.POINTER(ctypes.c_uint32))
+    lib.solver_abi_version.restype = ctypes.c_uint32
+    lib.solver_open.argtypes = [ctypes.c_char_p, ctypes.c_uint32]
+    lib.solver_open.restype = p
+    lib.solver_close.argtypes = [p]
+    lib.solver_parse_problem.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+    lib.solver_parse_problem.restype = p
+    lib.solver_free_problem.argtypes = [p]
+    lib.solver_solve.argtypes = [p, p, ctypes.POINTER(SolverOptions)]
+    lib.solver_solve.restype = p
+    lib.solver_free_solution.argtypes = [p]
+    lib.solver_solution_vertices.argtypes = [p, dp]
+    lib.solver_solution_vertices.restype = ctypes.c_size_t
+    lib.solver_solution_destination.argtypes = [p, dp]
+    lib.solver_solution_destination.restype = ctypes.c_size_t
+    lib.solver_solution_facets.argtypes = [p, up, up]
+    lib.solver_solution_facets.restype = ctypes.c_size_t
+    lib.solver_solution_resemblance.argtypes = [p]
+    lib.solver_solution_resemblance.restype = ctypes.c_double
+    if lib.solver_abi_version() != self.abi_version:
+      raise ApiError('libsolver ABI %d, expected %d' % (lib.solver_abi_version(), self.abi_version))
+    self.lib = lib
+    self.context = lib.solver_open(patterns.encode() if patterns else None, forward_depth)
+    if not self.context:
+      raise ApiError('libsolver cannot load %s' % patterns)
+
+  def close(self):
+    if self.context:
+      self.lib.solver_close(self.context)
+      self.context = None
+
+  def solve(self, spec, time_limit=0, numeric=0):
+    # a Solution of the spec as given, with its resemblance, or None
+    if not isinstance(spec, bytes):
+      spec = spec.encode('ascii')
+    prob = self.lib.solver_parse_problem(spec, len(spec))
+    if not prob:
+      return None
+    try:
+      sol = self.lib.solver_solve(self.context, prob, ctypes.byref(SolverOptions(numeric, time_limit)))
+    finally:
+      self.lib.solver_free_problem(prob)
+    if not sol:
+      return None
+    try:
+      def points(getter):
+        xy = ctypes.POINTER(ctypes.c_double)()
+        n = getter(sol, ctypes.byref(xy))
+        return [(xy[2 * i], xy[2 * i + 1]) for i in range(n)]
+      offsets = ctypes.POINTER(ctypes.c_uint32)()
+      indices = ctypes.POINTER(ctypes.c_uint32)()
+      n = self.lib.solver_solution_facets(sol, ctypes.byref(offsets), ctypes.byref(indices))
+      facets = [indices[offsets[k]:offsets[k + 1]] for k in range(n)]
+      res = Solution.from_arrays(points(self.lib.solver_solution_vertices), facets,
+        points(self.lib.solver_solution_destination))
+      res.resemblance = self.lib.solver_solution_resemblance(sol)
+      return res
+    finally:
+      self.lib.solver_free_solution(sol)
+
+
 class ApiError(Exception):
   pass
 
 class ApiClient:
 
     # api_endpoint = 'http://2016sv.icfpcontest.org/api'
-    api_endpoint = 'http://130.211.240.134/api'
+    api_endpoint = os.environ.get('API_ENDPOINT', 'http://130.211.240.134/api')
     api_key = os.environ['API_KEY']
 
     timestamp = None
@@ -403,7 +490,7 @@ class ApiClient:
       return [p for p in problems if p['owner'] == '116']
 
 if __name__ == '__main__':
-    usage = 'usage: api hello|status|problems|submit|parse|draw|preproc|postproc|draw-solution|submit-problem|my-problems'
+    usage = 'usage: api hello|status|problems|submit|parse|draw|preproc|postproc|solve|draw-solution|submit-problem|my-problems'
     api = ApiClient()
 
     if len(sys.argv) > 1:
@@ -478,6 +565,30 @@ if __name__ == '__main__':
               pp = ProblemPreprocessor()
               sol = pp.apply(sol, prob)
               print(sol.to_str())
+        elif cmd == 'solve':
+            if len(sys.argv) < 3:
+              print('usage: api solve problemfile...')
+            else:
+              # preproc, solve and postproc in this process, one solver for
+              # all; outcomes go to the results store, $RESULTS
+              store = results.Store()
+              solver = LibSolver()
+              pp = ProblemPreprocessor()
+              for fn in sys.argv[2:]:
+                with open(fn) as f:
+                  spec = f.read()
+                prob = Problem(spec)
+                start = time.time()
+                sol = solver.solve(pp.convert(prob).to_str(), time_limit=4.5)
+                wall = time.time() - start
+                pid = results.problem_id(fn)
+                print('%06d %s' % (pid, 'failed' if not sol else ('solved' if sol.resemblance >= 1 else 'partial')))
+                if sol:
+                  store.record_solution(pid, pp.apply(sol, prob).to_str() + '\n', sol.resemblance, wall)
+                else:
+                  store.record_attempt(pid, 'failed', wall)
+              solver.close()
+              store.close()
         elif cmd.startswith('draw-s'):
             if len(sys.argv) < 3:
               print('usage: api draw-solution solution')
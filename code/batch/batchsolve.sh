@@ -1,75 +1,113 @@
 #!/bin/bash
 
 SOLVER="${1:-./solve}"
+VALIDATOR="$(dirname "$SOLVER")/validate"
 PROBLEMS="../../spec/problems"
-SOLUTIONS="results"
-FAILED="failed"
 logFile="tempbatch.log"
 errorFile="tempbatch-err.log"
 tempSpec="tempbatch-spec.log"
+tempSolution="tempbatch-solution.log"
+tempStats="tempbatch-stats.log"
 
 if [ ! -x "$SOLVER" ]; then
   echo "usage: batchsolve [solver]"
   exit 1
 fi
 
+# trace events for chrome://tracing when TRACE names a file, see tracing.py
+if [ -n "$TRACE" ]; then
+  export TRACE="$(cd "$(dirname "$TRACE")" && pwd)/$(basename "$TRACE")"
+  flock "$TRACE" sh -c '[ -s "$TRACE" ] || printf "[\n" >> "$TRACE"'
+fi
+
+function now {
+  if [ -n "$EPOCHREALTIME" ]; then
+    echo "${EPOCHREALTIME/./}"
+  else
+    date +%s%6N
+  fi
+}
+
+function span {
+  # span NAME START [ARGS]
+  [ -n "$TRACE" ] || return 0
+  printf '{"name":"%s","cat":"batch","ph":"X","ts":%s,"dur":%s,"pid":%s,"tid":%s,"args":{%s}},\n' \
+    "$1" "$2" $(( $(now) - $2 )) $$ $$ "$3" >> "$TRACE"
+}
+
 function trysolve {
   specFile="$1"
 
   x="${specFile##*/}"
   x="${x%-*}"
   problemId=$((10#$x))
-  printf -v PROB "%06d" $problemId
 
-  mkdir -p "$SOLUTIONS"
+  echo "$specFile"
+  problemStart=$(now)
+  t=$(now)
 
-  tempFile="$FAILED/$PROB-failed.txt"
-  OUTFILE="$SOLUTIONS/$PROB-solved.txt"
+  rm -f "$logFile" "$errorFile" "$tempSpec" "$tempSolution" "$tempSolution.solv" "$tempStats"
 
-  if [ ! -s "$OUTFILE" ]; then
-    if [ -s "$tempFile" ]; then
-      # echo "skipping $tempFile"
-      return
-    fi
+  span files $t
+  t=$(now)
 
-    echo "$specFile"
+  ./api.py preproc "$specFile" > "$tempSpec"
 
-    [ -f "$logFile" ] && rm "$logFile"
-    [ -f "$errorFile" ] && rm "$errorFile"
-    [ -f "$tempSpec" ] && rm "$tempSpec"
-    [ -f "$tempFile.solv" ] && rm "$tempFile.solv"
+  span preproc $t
+  t=$(now)
 
-    ./api.py preproc "$specFile" > "$tempSpec"
+  timeout 5 "$SOLVER" -t 4.5 -p "$tempStats" ${TRACE:+-e "$TRACE"} -f "$tempSpec" > "$tempSolution.solv"
+  wallTime=$(( $(now) - t ))
 
-    timeout 5 "$SOLVER" -f "$tempSpec" > "$tempFile.solv"
+  # below 1 for a partial answer to a silhouette of several polygons
+  resemblance=$(grep -o '"resemblance":[0-9.e+-]*' "$tempStats" 2> /dev/null | tail -n 1 | cut -d: -f2)
 
-    if [ -s "$tempFile.solv" ]; then
-      ./api.py postproc "$specFile" "$tempFile.solv" | tee "$tempFile" \
-        && sleep 1 \
-        && ./api.py submit "$problemId" "$tempFile" 1> "$logFile" 2> "$errorFile" \
-        && mv "$tempFile" "$OUTFILE"
+  span solve $t
+  t=$(now)
 
-      if [ -s "$logFile" -a -s "$OUTFILE" ]; then
-        cat "$logFile" >> "$OUTFILE"
-        tail -n 1 "$logFile"
-      fi
-    else
-      echo "failed" >> "$tempFile"
-    fi
+  # outcomes go to the results store, see results.py; the submitter
+  # records what the server said
+  status=failed
+  if [ -s "$tempSolution.solv" ]; then
+    ./api.py postproc "$specFile" "$tempSolution.solv" | tee "$tempSolution" \
+      && { [ ! -x "$VALIDATOR" ] || "$VALIDATOR" -q "$tempSolution" > "$errorFile"; } \
+      && ./outbox.py put "$problemId" "$tempSolution" 1> "$logFile" 2> "$errorFile" \
+      && status=solved
 
-    if [ -s "$errorFile" ]; then
-      cat "$errorFile" >> "$tempFile"
-      tail -n 1 "$errorFile"
+    if [ -s "$logFile" ]; then
+      tail -n 1 "$logFile"
     fi
+    span postproc $t
+  fi
+  t=$(now)
 
-    [ -f "$logFile" ] && rm "$logFile"
-    [ -f "$errorFile" ] && rm "$errorFile"
-    [ -f "$tempSpec" ] && rm "$tempSpec"
-    [ -f "$tempFile.solv" ] && rm "$tempFile.solv"
+  if [ $status = solved ]; then
+    ./results.py put "$problemId" "$tempSolution" --resemblance "${resemblance:-1}" --wall-time "$wallTime"e-6
+  else
+    ./results.py fail "$problemId" --wall-time "$wallTime"e-6
+  fi
 
+  if [ -s "$errorFile" ]; then
+    tail -n 1 "$errorFile"
   fi
+
+  rm -f "$logFile" "$errorFile" "$tempSpec" "$tempSolution" "$tempSolution.solv" "$tempStats"
+
+  span files $t
+  span problem $problemStart "\"problem_id\":$problemId"
 }
 
-for f in "$PROBLEMS/"*-spec.txt ; do
+# submissions go out in the background at the API rate, see outbox.py
+./outbox.py drain --follow &
+drainer=$!
+trap 'kill $drainer 2> /dev/null' EXIT
+
+# problems with no outcome recorded yet, solved or failed
+mapfile -t specs < <(./results.py pending "$PROBLEMS/"*-spec.txt)
+for f in "${specs[@]}" ; do
   trysolve "$f"
 done
+
+kill $drainer 2> /dev/null
+wait $drainer 2> /dev/null
+./outbox.py drain
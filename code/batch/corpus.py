@@ -0,0 +1,282 @@
+#!/usr/bin/env python
+from __future__ import print_function, division
+import argparse
+import glob
+import json
+import os
+import random
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+
+DEFAULT_PROBLEMS = '../../spec/problems'
+DEFAULT_BASELINE = 'corpus-baseline.json'
+
+
+def spec_file(problems, pid):
+  return os.path.join(problems, '%06d-spec.txt' % pid)
+
+
+def load_meta(problems):
+  res = []
+  for fn in sorted(glob.glob(os.path.join(problems, '*-meta.json'))):
+    with open(fn) as f:
+      meta = json.load(f)
+    if os.path.exists(spec_file(problems, meta['problem_id'])):
+      res.append({'problem_id': meta['problem_id'], 'problem_size': meta['problem_size']})
+  return res
+
+
+def stratified_sample(problems, bins, per_bin, seed):
+  # equal-count bins over problem_size, so every difficulty band is represented
+  ordered = sorted(problems, key=lambda p: (p['problem_size'], p['problem_id']))
+  rng = random.Random(seed)
+  res = []
+  for b in range(bins):
+    lo = len(ordered) * b // bins
+    hi = len(ordered) * (b + 1) // bins
+    band = ordered[lo:hi]
+    picked = rng.sample(band, min(per_bin, len(band)))
+    for p in sorted(picked, key=lambda p: p['problem_id']):
+      x = dict(p)
+      x['bin'] = b
+      res.append(x)
+  return res
+
+
+def read_stats(fn):
+  # the solver may report a JSON record on stderr; take the last one
+  stats = None
+  with open(fn) as f:
+    for line in f:
+      line = line.strip()
+      if line.startswith('{'):
+        try:
+          stats = json.loads(line)
+        except ValueError:
+          pass
+  return stats
+
+
+def run_one(solver, spec, timeout, solver_args):
+  # the solver gets what batchsolve gives it, the spec shifted and scaled
+  # by api.py preproc; preprocessing is not timed
+  prep = tempfile.NamedTemporaryFile(prefix='temp-corpus-', suffix='.txt', delete=False)
+  out = tempfile.NamedTemporaryFile(prefix='temp-corpus-', delete=False)
+  err = tempfile.NamedTemporaryFile(prefix='temp-corpus-', delete=False)
+  try:
+    prep.write(subprocess.check_output(['./api.py', 'preproc', spec]))
+    prep.close()
+
+    start = time.time()
+    pid = os.fork()
+    if pid == 0:
+      os.dup2(out.fileno(), 1)
+      os.dup2(err.fileno(), 2)
+      try:
+        os.execv(solver, [solver] + solver_args + ['-f', prep.name])
+      finally:
+        os._exit(127)
+
+    timedout = False
+    while True:
+      wpid, status, usage = os.wait4(pid, os.WNOHANG)
+      if wpid != 0:
+        break
+      if time.time() - start > timeout and not timedout:
+        os.kill(pid, signal.SIGKILL)
+        timedout = True
+      time.sleep(0.002)
+    wall = time.time() - start
+
+    out.close()
+    err.close()
+    answered = not timedout and os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0 \
+      and os.path.getsize(out.name) > 0
+    stats = read_stats(err.name)
+    # a silhouette of several polygons may get a partial answer, the stats
+    # say how close; without stats an answer counts as exact
+    resemblance = (stats or {}).get('resemblance', 1.0) if answered else 0.0
+    solved = resemblance >= 1
+
+    return {
+      'status': 'timeout' if timedout else ('solved' if solved else ('partial' if answered else 'failed')),
+      'solved': solved,
+      'resemblance': resemblance,
+      'wall_time': round(wall, 4),
+      'peak_rss_kb': usage.ru_maxrss,
+      'nodes_expanded': stats.get('nodes_expanded') if stats else None,
+      'stats': stats,
+    }
+  finally:
+    os.unlink(prep.name)
+    os.unlink(out.name)
+    os.unlink(err.name)
+
+
+def summarize(results):
+  solved = [r for r in results if r['solved']]
+  return {
+    'problems': len(results),
+    'solved': len(solved),
+    'partial': len([r for r in results if r['status'] == 'partial']),
+    'timeouts': len([r for r in results if r['status'] == 'timeout']),
+    'wall_time': round(sum(r['wall_time'] for r in results), 4),
+    'solved_wall_time': round(sum(r['wall_time'] for r in solved), 4),
+    'peak_rss_kb': max([r['peak_rss_kb'] for r in results] or [0]),
+  }
+
+
+def run(args):
+  problems = load_meta(args.problems)
+  if args.sample:
+    with open(args.sample) as f:
+      sample = json.load(f)['sample']
+  else:
+    sample = stratified_sample(problems, args.bins, args.per_bin, args.seed)
+
+  solver = os.path.abspath(args.solver)
+  solver_args = args.solver_args.split() if args.solver_args else []
+  results = []
+  for p in sample:
+    r = run_one(solver, spec_file(args.problems, p['problem_id']), args.timeout, solver_args)
+    r.update({'problem_id': p['problem_id'], 'problem_size': p['problem_size'], 'bin': p['bin']})
+    results.append(r)
+    print('%06d  bin %d  %-8s %8.3fs %8d KB' % (p['problem_id'], p['bin'], r['status'], r['wall_time'], r['peak_rss_kb']),
+      file=sys.stderr)
+
+  report = {
+    'timeout': args.timeout,
+    'sample': sample,
+    'results': results,
+    'summary': summarize(results),
+  }
+  with open(args.out, 'w') as f:
+    json.dump(report, f, indent=1, sort_keys=True)
+  print(json.dumps(report['summary'], sort_keys=True))
+  return report
+
+
+def compare(baseline, current, args):
+  base = dict((r['problem_id'], r) for r in baseline['results'])
+  failures = []
+
+  lost = [pid for pid, r in sorted(base.items()) if r['solved']
+    and not any(c['problem_id'] == pid and c['solved'] for c in current['results'])]
+  gained = [c['problem_id'] for c in current['results'] if c['solved']
+    and not (c['problem_id'] in base and base[c['problem_id']]['solved'])]
+  if len(lost) > args.max_lost:
+    failures.append('lost %d solves: %s' % (len(lost), ' '.join(str(x) for x in lost)))
+
+  # latency only over problems both runs solved, timeouts say nothing about speed
+  both = [(base[c['problem_id']], c) for c in current['results']
+    if c['solved'] and c['problem_id'] in base and base[c['problem_id']]['solved']]
+  # short solves are clamped so process startup jitter does not trip the check
+  base_time = sum(max(b['wall_time'], args.min_time) for b, c in both)
+  cur_time = sum(max(c['wall_time'], args.min_time) for b, c in both)
+  time_ratio = cur_time / base_time if base_time > 0 else 1.0
+  if time_ratio > args.time_threshold:
+    failures.append('solve time x%.2f over threshold x%.2f' % (time_ratio, args.time_threshold))
+
+  base_rss = max([b['peak_rss_kb'] for b, c in both] or [0])
+  cur_rss = max([c['peak_rss_kb'] for b, c in both] or [0])
+  rss_ratio = cur_rss / base_rss if base_rss > 0 else 1.0
+  if rss_ratio > args.memory_threshold:
+    failures.append('peak memory x%.2f over threshold x%.2f' % (rss_ratio, args.memory_threshold))
+
+  # allocations per expanded node, from solvers built with COUNT_ALLOCATIONS;
+  # they do not depend on timing, so a small threshold holds
+  def per_node(runs):
+    stats = [r.get('stats') or {} for r in runs]
+    nodes = sum(x.get('nodes_expanded', 0) for x in stats if x.get('allocations'))
+    return sum(x.get('allocations') or 0 for x in stats) / nodes if nodes > 0 else None
+  base_alloc = per_node([b for b, c in both])
+  cur_alloc = per_node([c for b, c in both])
+  alloc_ratio = None
+  if base_alloc is not None:
+    if cur_alloc is None:
+      failures.append('no allocation counts, build the solver with -DCOUNT_ALLOCATIONS=ON')
+    else:
+      alloc_ratio = cur_alloc / base_alloc
+      if alloc_ratio > args.allocation_threshold:
+        failures.append('allocations per node x%.2f over threshold x%.2f' % (alloc_ratio, args.allocation_threshold))
+
+  slowest = sorted(both, key=lambda x: x[1]['wall_time'] / max(x[0]['wall_time'], 0.001), reverse=True)
+  for b, c in slowest[:5]:
+    print('%06d  %8.3fs -> %8.3fs' % (c['problem_id'], b['wall_time'], c['wall_time']), file=sys.stderr)
+
+  print(json.dumps({
+    'lost': lost,
+    'gained': gained,
+    'time_ratio': round(time_ratio, 4),
+    'memory_ratio': round(rss_ratio, 4),
+    'allocation_ratio': round(alloc_ratio, 4) if alloc_ratio is not None else None,
+    'failures': failures,
+    'pass': len(failures) == 0,
+  }, sort_keys=True))
+  return len(failures) == 0
+
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(description='corpus regression benchmark')
+  sub = parser.add_subparsers(dest='cmd')
+
+  def run_options(p):
+    p.add_argument('--solver', default='./solve')
+    p.add_argument('--solver-args', default='-p -', help='extra solver options')
+    p.add_argument('--problems', default=DEFAULT_PROBLEMS)
+    p.add_argument('--bins', type=int, default=5)
+    p.add_argument('--per-bin', type=int, default=12)
+    p.add_argument('--seed', type=int, default=2016)
+    p.add_argument('--timeout', type=float, default=5)
+    p.add_argument('--sample', help='reuse the sample of a previous report')
+
+  def compare_options(p):
+    p.add_argument('--max-lost', type=int, default=0)
+    p.add_argument('--time-threshold', type=float, default=1.25)
+    p.add_argument('--min-time', type=float, default=0.05)
+    p.add_argument('--memory-threshold', type=float, default=1.5)
+    p.add_argument('--allocation-threshold', type=float, default=1.1)
+
+  p = sub.add_parser('run', help='solve the sample and write a report')
+  run_options(p)
+  p.add_argument('--out', default='temp-corpus-run.json')
+
+  p = sub.add_parser('baseline', help='solve the sample and store it as the baseline')
+  run_options(p)
+  p.add_argument('--out', default=DEFAULT_BASELINE)
+
+  p = sub.add_parser('check', help='solve the baseline sample and compare')
+  run_options(p)
+  compare_options(p)
+  p.add_argument('--baseline', default=DEFAULT_BASELINE)
+  p.add_argument('--out', default='temp-corpus-run.json')
+
+  p = sub.add_parser('compare', help='compare two reports')
+  compare_options(p)
+  p.add_argument('baseline')
+  p.add_argument('current')
+
+  args = parser.parse_args()
+
+  if args.cmd in ('run', 'baseline'):
+    run(args)
+  elif args.cmd == 'check':
+    if not args.sample:
+      args.sample = args.baseline
+    with open(args.baseline) as f:
+      baseline = json.load(f)
+    current = run(args)
+    sys.exit(0 if compare(baseline, current, args) else 1)
+  elif args.cmd == 'compare':
+    with open(args.baseline) as f:
+      baseline = json.load(f)
+    with open(args.current) as f:
+      current = json.load(f)
+    sys.exit(0 if compare(baseline, current, args) else 1)
+  else:
+    parser.print_help()
+    sys.exit(2)
@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+from __future__ import print_function, division
+import argparse
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+import results
+
+
+class SolverServer:
+  # one resident solver, either a child on stdin/stdout (solve -i) or a
+  # server already listening on a Unix socket (solve -l PATH)
+
+  def __init__(self, solver='./solve', solver_args=[], socket_path=None):
+    self.proc = None
+    self.sock = None
+    if socket_path:
+      self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+      self.sock.connect(socket_path)
+      self.rfile = self.sock.makefile('rb')
+      self.wfile = self.sock.makefile('wb')
+    else:
+      self.proc = subprocess.Popen([solver, '-i'] + solver_args,
+        stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+      self.rfile = self.proc.stdout
+      self.wfile = self.proc.stdin
+    self.last_id = 0
+
+  def solve(self, spec):
+    # solution text, or None when the solver gave up; a request the solver
+    # did not understand raises, it hangs up after that
+    if not isinstance(spec, bytes):
+      spec = spec.encode('ascii')
+    self.last_id += 1
+    self.wfile.write(('solve %d %d\n' % (self.last_id, len(spec))).encode('ascii'))
+    self.wfile.write(spec)
+    self.wfile.flush()
+
+    header = self.rfile.readline().split()
+    if len(header) != 3 or int(header[1]) != self.last_id:
+      raise IOError('solver protocol error: %r' % header)
+    body = self.rfile.read(int(header[2]))
+    if header[0] == b'error':
+      raise IOError('solver rejected request %d' % self.last_id)
+    return body.decode('ascii') if header[0] == b'solved' else None
+
+  def close(self):
+    self.wfile.close()
+    self.rfile.close()
+    if self.sock:
+      self.sock.close()
+    if self.proc:
+      self.proc.wait()
+
+
+def last_stats(fn, offset):
+  # the solver appends a record per request; read only what is new
+  stats = None
+  with open(fn) as f:
+    f.seek(offset)
+    for line in f:
+      if line.startswith('{'):
+        try:
+          stats = json.loads(line)
+        except ValueError:
+          pass
+    return stats, f.tell()
+
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(description='solve specs through one resident solver')
+  parser.add_argument('--solver', default='./solve')
+  parser.add_argument('--solver-args', default='', help='extra solver options')
+  parser.add_argument('--socket', help='connect to solve -l SOCKET instead of starting one')
+  parser.add_argument('--stats', help='the -p file of the solve -l server, for the resemblance of partial answers')
+  parser.add_argument('--results', default=os.environ.get('RESULTS', results.DEFAULT_STORE), help='results store')
+  parser.add_argument('specs', nargs='+')
+  args = parser.parse_args()
+
+  stats_name = args.stats
+  solver_args = args.solver_args.split()
+  if not args.socket:
+    stats_file = tempfile.NamedTemporaryFile(prefix='temp-daemon-', delete=False)
+    stats_file.close()
+    stats_name = stats_file.name
+    solver_args = ['-p', stats_name] + solver_args
+  offset = os.path.getsize(stats_name) if stats_name and os.path.exists(stats_name) else 0
+
+  server = SolverServer(args.solver, solver_args, args.socket)
+  store = results.Store(args.results)
+
+  # the batchsolve pipeline around the resident solver: preproc, solve,
+  # postproc, validate
+  validator = os.path.join(os.path.dirname(args.solver), 'validate')
+  temp = tempfile.NamedTemporaryFile(prefix='temp-daemon-', suffix='.txt', delete=False)
+  temp.close()
+
+  solved = 0
+  for fn in args.specs:
+    pid = results.problem_id(fn)
+    spec = subprocess.check_output(['./api.py', 'preproc', fn])
+    start = time.time()
+    solution = server.solve(spec)
+    wall = time.time() - start
+    stats = None
+    if stats_name:
+      stats, offset = last_stats(stats_name, offset)
+    if solution:
+      with open(temp.name, 'w') as f:
+        f.write(solution)
+      solution = subprocess.check_output(['./api.py', 'postproc', fn, temp.name])
+      with open(temp.name, 'wb') as f:
+        f.write(solution)
+      if os.path.exists(validator) and subprocess.call([validator, '-q', temp.name]) != 0:
+        solution = None
+    # a silhouette of several polygons may get a partial answer
+    resemblance = (stats or {}).get('resemblance', 1.0) if solution else 0.0
+    status = 'solved' if resemblance >= 1 else ('partial' if solution else 'failed')
+    print('%06d  %-7s %8.3fs' % (pid, status, wall), file=sys.stderr)
+    solved += status == 'solved'
+    if solution:
+      store.record_solution(pid, solution.decode('utf-8'), resemblance, wall)
+    else:
+      store.record_attempt(pid, status, wall)
+
+  os.unlink(temp.name)
+  server.close()
+  store.close()
+  if not args.socket:
+    os.unlink(stats_name)
+  print('%d/%d solved' % (solved, len(args.specs)))
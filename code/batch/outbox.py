@@ -0,0 +1,326 @@
+#!/usr/bin/env python
+from __future__ import print_function, division
+import argparse
+import fcntl
+import glob
+import hashlib
+import json
+import os
+import random
+import sys
+import threading
+import time
+
+import results
+import tracing
+
+try:
+  from urllib.request import Request, urlopen
+  from urllib.parse import urlencode
+  from urllib.error import HTTPError, URLError
+  from http.server import BaseHTTPRequestHandler, HTTPServer
+except ImportError:
+  from urllib2 import Request, urlopen, HTTPError, URLError
+  from urllib import urlencode
+  from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+
+
+# Submission queue on disk. Solvers put solutions in, one submitter drains
+# them at the API rate, so solving never waits on the network.
+#
+#   pending/PID.json    waiting, or backing off until not_before
+#   inflight/PID.json   being submitted; moved back to pending on restart
+#   sent/PID.json       accepted, with the API response
+#   failed/PID.json     rejected, or out of retries
+#
+# Every state change is a rename, so a crash leaves each entry in exactly
+# one place. One entry per problem: a newer solution replaces a pending
+# one, and a solution already sent is not queued again.
+
+DEFAULT_OUTBOX = 'outbox'
+DEFAULT_ENDPOINT = 'http://130.211.240.134/api'
+STATES = ['pending', 'inflight', 'sent', 'failed']
+
+
+def entry_path(outbox, state, pid):
+  return os.path.join(outbox, state, '%06d.json' % pid)
+
+
+def read_entry(fn):
+  try:
+    with open(fn) as f:
+      return json.load(f)
+  except (IOError, OSError, ValueError):
+    return None
+
+
+def write_entry(outbox, state, entry):
+  fn = entry_path(outbox, state, entry['problem_id'])
+  temp = '%s.%d.tmp' % (fn, os.getpid())
+  with open(temp, 'w') as f:
+    json.dump(entry, f, sort_keys=True)
+    f.flush()
+    os.fsync(f.fileno())
+  os.rename(temp, fn)
+
+
+def move_entry(outbox, src, dst, pid):
+  try:
+    os.rename(entry_path(outbox, src, pid), entry_path(outbox, dst, pid))
+    return True
+  except OSError:
+    return False
+
+
+def prepare(outbox):
+  for state in STATES:
+    d = os.path.join(outbox, state)
+    if not os.path.exists(d):
+      os.makedirs(d)
+
+
+def put(outbox, pid, spec):
+  prepare(outbox)
+  digest = hashlib.sha1(spec.encode('utf-8')).hexdigest()
+  for state in ['sent', 'inflight', 'pending']:
+    old = read_entry(entry_path(outbox, state, pid))
+    if old is not None and old['hash'] == digest:
+      return 'duplicate'
+
+  write_entry(outbox, 'pending', {
+    'problem_id': pid,
+    'hash': digest,
+    'solution': spec,
+    'attempts': 0,
+    'not_before': 0,
+    'enqueued': time.time(),
+  })
+  return 'queued'
+
+
+class RateLimiter:
+  # request starts at least interval seconds apart
+
+  def __init__(self, interval):
+    self.interval = interval
+    self.last = None
+
+  def wait(self):
+    if self.last is not None:
+      x = self.last + self.interval - time.time()
+      if x > 0:
+        time.sleep(x)
+    self.last = time.time()
+
+
+def post_solution(endpoint, api_key, pid, spec, timeout):
+  # (status, body); status 0 when the server could not be reached
+  data = urlencode({'problem_id': pid, 'solution_spec': spec}).encode('ascii')
+  req = Request('%s/solution/submit' % endpoint, data=data, headers={'X-API-Key': api_key})
+  try:
+    r = urlopen(req, timeout=timeout)
+    return r.getcode(), r.read().decode('utf-8')
+  except HTTPError as e:
+    return e.code, e.read().decode('utf-8')
+  except (URLError, IOError, OSError) as e:
+    return 0, str(e)
+
+
+def response_resemblance(body):
+  # what the server scored the solution, None when it did not say
+  try:
+    r = json.loads(body)
+    return float(r['resemblance'])
+  except (ValueError, KeyError, TypeError):
+    return None
+
+
+def retryable(status):
+  return status == 0 or status == 429 or status >= 500
+
+
+def next_ready(outbox):
+  entries = [read_entry(fn) for fn in glob.glob(os.path.join(outbox, 'pending', '*.json'))]
+  entries = [e for e in entries if e is not None]
+  if not entries:
+    return None, None
+  now = time.time()
+  ready = [e for e in entries if e['not_before'] <= now]
+  if ready:
+    return min(ready, key=lambda e: e['enqueued']), None
+  return None, min(e['not_before'] for e in entries)
+
+
+def drain(args):
+  prepare(args.outbox)
+
+  # a second submitter would break the rate limit
+  lock = open(os.path.join(args.outbox, 'drain.lock'), 'w')
+  try:
+    fcntl.flock(lock, fcntl.LOCK_EX | fcntl.LOCK_NB)
+  except IOError:
+    print('another submitter is draining %s' % args.outbox, file=sys.stderr)
+    return 2
+
+  # whatever was in flight when the last submitter died goes out again
+  for fn in glob.glob(os.path.join(args.outbox, 'inflight', '*.json')):
+    entry = read_entry(fn)
+    if entry is None:
+      os.unlink(fn)
+    elif not os.path.exists(entry_path(args.outbox, 'pending', entry['problem_id'])):
+      move_entry(args.outbox, 'inflight', 'pending', entry['problem_id'])
+    else:
+      os.unlink(fn)
+
+  store = results.Store(args.results)
+  trace = tracing.open_trace()
+  trace.name_thread('submitter')
+  limiter = RateLimiter(args.interval)
+  sent = failed = 0
+  while True:
+    entry, wake = next_ready(args.outbox)
+    if entry is None:
+      if wake is None and not args.follow:
+        break
+      with trace.span('idle'):
+        time.sleep(min(max(wake - time.time(), 0.05), 1.0) if wake else 0.2)
+      continue
+
+    pid = entry['problem_id']
+    if not move_entry(args.outbox, 'pending', 'inflight', pid):
+      continue
+    # a put may have replaced the entry since it was read; what was moved
+    # is what goes out
+    entry = read_entry(entry_path(args.outbox, 'inflight', pid))
+    if entry is None:
+      os.unlink(entry_path(args.outbox, 'inflight', pid))
+      continue
+
+    with trace.span('rate limit', problem_id=pid):
+      limiter.wait()
+    with trace.span('submit', problem_id=pid) as span:
+      status, body = post_solution(args.endpoint, args.api_key, pid, entry['solution'], args.timeout)
+      span['status'] = status
+    entry['attempts'] += 1
+    entry['status'] = status
+    entry['response'] = body
+
+    if status == 200:
+      write_entry(args.outbox, 'sent', entry)
+      os.unlink(entry_path(args.outbox, 'inflight', pid))
+      store.record_submission(pid, 'sent', hash=entry['hash'], resemblance=response_resemblance(body),
+        response=body, attempts=entry['attempts'])
+      sent += 1
+      print('%06d sent %s' % (pid, body.strip()[:120]), file=sys.stderr)
+    elif retryable(status) and entry['attempts'] < args.retries:
+      # a newer solution queued meanwhile supersedes this one
+      if not os.path.exists(entry_path(args.outbox, 'pending', pid)):
+        entry['not_before'] = time.time() + min(args.backoff * 2 ** (entry['attempts'] - 1), 300)
+        write_entry(args.outbox, 'pending', entry)
+      os.unlink(entry_path(args.outbox, 'inflight', pid))
+      print('%06d retry %d: %s %s' % (pid, entry['attempts'], status, body.strip()[:120]), file=sys.stderr)
+    else:
+      write_entry(args.outbox, 'failed', entry)
+      os.unlink(entry_path(args.outbox, 'inflight', pid))
+      store.record_submission(pid, 'failed', hash=entry['hash'], response=body, attempts=entry['attempts'])
+      failed += 1
+      print('%06d failed: %s %s' % (pid, status, body.strip()[:120]), file=sys.stderr)
+
+  store.close()
+  print(json.dumps({'sent': sent, 'failed': failed}))
+  return 0
+
+
+def status(args):
+  prepare(args.outbox)
+  print(json.dumps(dict((state, len(glob.glob(os.path.join(args.outbox, state, '*.json'))))
+    for state in STATES), sort_keys=True))
+
+
+class StubHandler(BaseHTTPRequestHandler):
+  # stand-in for the contest API: enforces the request rate and fails a
+  # share of requests, so the submitter can be tested offline
+
+  lock = threading.Lock()
+  last = 0.0
+  interval = 1.0
+  error_rate = 0.0
+  accepted = {}
+
+  def reply(self, code, body):
+    data = json.dumps(body).encode('utf-8')
+    self.send_response(code)
+    self.send_header('Content-Type', 'application/json')
+    self.send_header('Content-Length', str(len(data)))
+    self.end_headers()
+    self.wfile.write(data)
+
+  def do_POST(self):
+    size = int(self.headers.get('Content-Length') or 0)
+    self.rfile.read(size)
+    cls = StubHandler
+    with cls.lock:
+      now = time.time()
+      early = now - cls.last < cls.interval
+      cls.last = now
+    if self.path.rstrip('/').split('/')[-2:] != ['solution', 'submit']:
+      return self.reply(404, {'ok': False, 'error': 'not found'})
+    if early:
+      return self.reply(429, {'ok': False, 'error': 'rate limit exceeded'})
+    if random.random() < cls.error_rate:
+      return self.reply(503, {'ok': False, 'error': 'try again'})
+    return self.reply(200, {'ok': True, 'resemblance': 1.0})
+
+  def log_message(self, fmt, *args):
+    pass
+
+
+def stub(args):
+  StubHandler.interval = args.interval
+  StubHandler.error_rate = args.error_rate
+  server = HTTPServer(('127.0.0.1', args.port), StubHandler)
+  print('stub API on http://127.0.0.1:%d' % args.port, file=sys.stderr)
+  server.serve_forever()
+
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(description='on-disk submission queue')
+  parser.add_argument('--outbox', default=os.environ.get('OUTBOX', DEFAULT_OUTBOX))
+  sub = parser.add_subparsers(dest='cmd')
+
+  p = sub.add_parser('put', help='queue a solution for submission')
+  p.add_argument('problem_id', type=int)
+  p.add_argument('solution')
+
+  p = sub.add_parser('drain', help='submit queued solutions at the API rate')
+  p.add_argument('--endpoint', default=os.environ.get('API_ENDPOINT', DEFAULT_ENDPOINT))
+  p.add_argument('--api-key', default=os.environ.get('API_KEY', ''))
+  p.add_argument('--interval', type=float, default=1.1, help='seconds between requests')
+  p.add_argument('--retries', type=int, default=8)
+  p.add_argument('--backoff', type=float, default=2.0, help='first retry delay, doubled after each')
+  p.add_argument('--timeout', type=float, default=30)
+  p.add_argument('--follow', action='store_true', help='keep waiting for new entries')
+  p.add_argument('--results', default=os.environ.get('RESULTS', results.DEFAULT_STORE), help='store to record outcomes in')
+
+  p = sub.add_parser('status', help='count entries in each state')
+
+  p = sub.add_parser('stub', help='run a local stand-in for the API')
+  p.add_argument('--port', type=int, default=8016)
+  p.add_argument('--interval', type=float, default=1.0)
+  p.add_argument('--error-rate', type=float, default=0.0)
+
+  args = parser.parse_args()
+
+  if args.cmd == 'put':
+    with open(args.solution) as f:
+      spec = f.read()
+    print(put(args.outbox, args.problem_id, spec))
+  elif args.cmd == 'drain':
+    sys.exit(drain(args))
+  elif args.cmd == 'status':
+    status(args)
+  elif args.cmd == 'stub':
+    stub(args)
+  else:
+    parser.print_help()
+    sys.exit(2)
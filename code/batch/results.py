@@ -0,0 +1,289 @@
+#!/usr/bin/env python
+from __future__ import print_function, division
+import argparse
+import fcntl
+import glob
+import hashlib
+import json
+import os
+import re
+import sys
+import time
+
+
+# Results of every run in one store, instead of a text file per problem:
+#
+#   store/log          append-only, one JSON record per line
+#   store/index.json   problem id -> summary, and how much of the log it covers
+#
+# Records are solutions, failed attempts and submission outcomes. The best
+# solution of a problem has the highest resemblance, then the smallest
+# size, as the contest ranks them. The resemblance the server reports for
+# a submission replaces the solver's estimate for the same solution text. Writers append under an exclusive lock
+# and never rewrite the log; the index is a cache of it, saved now and
+# then, and brought up to date by reading the log past the point it covers.
+
+DEFAULT_STORE = 'store'
+INDEX_EVERY = 64
+
+
+def text_size(text):
+  return len(re.sub(r'\s', '', text))
+
+
+def text_hash(text):
+  # the same digest outbox.py keys submissions by
+  return hashlib.sha1(text.encode('utf-8')).hexdigest()
+
+
+class Store:
+
+  def __init__(self, path=None):
+    self.path = path or os.environ.get('RESULTS', DEFAULT_STORE)
+    if not os.path.exists(self.path):
+      os.makedirs(self.path)
+    self.log_name = os.path.join(self.path, 'log')
+    self.index_name = os.path.join(self.path, 'index.json')
+    self.fd = os.open(self.log_name, os.O_RDWR | os.O_APPEND | os.O_CREAT, 0o644)
+    self.entries = {}
+    self.covered = 0
+    self.unsaved = 0
+
+    try:
+      with open(self.index_name) as f:
+        saved = json.load(f)
+      if saved['covered'] <= os.fstat(self.fd).st_size:
+        self.entries = dict((int(k), v) for k, v in saved['entries'].items())
+        self.covered = saved['covered']
+    except (IOError, OSError, ValueError, KeyError):
+      pass
+    self.refresh()
+
+  def close(self):
+    if self.unsaved:
+      self.save_index()
+    os.close(self.fd)
+
+  def entry(self, pid):
+    return self.entries.setdefault(pid, {
+      'problem_id': pid, 'status': 'new', 'attempts': 0, 'solve_time': 0.0,
+      'resemblance': 0.0, 'size': None, 'offset': None, 'submission': None,
+    })
+
+  def apply(self, r, offset):
+    e = self.entry(r['problem_id'])
+    op = r['op']
+    if op in ('solution', 'attempt'):
+      e['attempts'] += 1
+      e['solve_time'] = round(e['solve_time'] + r.get('wall_time', 0), 4)
+    if op == 'solution':
+      better = e['offset'] is None or (r['resemblance'], -r['size']) > (e['resemblance'], -e['size'])
+      if better:
+        e['resemblance'] = r['resemblance']
+        e['size'] = r['size']
+        e['offset'] = offset
+        e['hash'] = text_hash(r['solution'])
+      e['status'] = 'solved' if e['resemblance'] >= 1 else 'partial'
+    elif op == 'attempt':
+      if e['offset'] is None:
+        e['status'] = r['status']
+    elif op == 'submission':
+      e['submission'] = {'status': r['status'], 'hash': r.get('hash'), 'time': r.get('time'),
+        'resemblance': r.get('resemblance')}
+      if r.get('resemblance') is not None and e['offset'] is not None and r.get('hash') == e.get('hash'):
+        e['resemblance'] = r['resemblance']
+        e['status'] = 'solved' if e['resemblance'] >= 1 else 'partial'
+    e['updated'] = r.get('time')
+
+  def refresh(self):
+    # replay what other writers appended since we last looked
+    size = os.fstat(self.fd).st_size
+    if size <= self.covered:
+      return
+    with open(self.log_name, 'rb') as f:
+      f.seek(self.covered)
+      offset = self.covered
+      for line in f:
+        if not line.endswith(b'\n'):
+          break
+        try:
+          self.apply(json.loads(line.decode('utf-8')), offset)
+        except (ValueError, KeyError):
+          pass
+        offset += len(line)
+        self.unsaved += 1
+      self.covered = offset
+
+  def append(self, r):
+    r.setdefault('time', round(time.time(), 3))
+    data = (json.dumps(r, sort_keys=True) + '\n').encode('utf-8')
+    fcntl.flock(self.fd, fcntl.LOCK_EX)
+    try:
+      self.refresh()
+      size = os.fstat(self.fd).st_size
+      # a writer that died mid-record left a partial line; end it
+      if size > self.covered:
+        os.write(self.fd, b'\n')
+        size += 1
+      os.write(self.fd, data)
+      self.apply(r, size)
+      self.covered = size + len(data)
+      self.unsaved += 1
+      if self.unsaved >= INDEX_EVERY:
+        self.save_index()
+    finally:
+      fcntl.flock(self.fd, fcntl.LOCK_UN)
+
+  def save_index(self):
+    temp = '%s.%d.tmp' % (self.index_name, os.getpid())
+    with open(temp, 'w') as f:
+      json.dump({'covered': self.covered, 'entries': self.entries}, f, sort_keys=True)
+    os.rename(temp, self.index_name)
+    self.unsaved = 0
+
+  def record_solution(self, pid, text, resemblance=1.0, wall_time=0, **extra):
+    r = {'op': 'solution', 'problem_id': pid, 'solution': text, 'resemblance': resemblance,
+      'size': text_size(text), 'wall_time': round(wall_time, 4)}
+    r.update(extra)
+    self.append(r)
+
+  def record_attempt(self, pid, status, wall_time=0, **extra):
+    r = {'op': 'attempt', 'problem_id': pid, 'status': status, 'wall_time': round(wall_time, 4)}
+    r.update(extra)
+    self.append(r)
+
+  def record_submission(self, pid, status, **extra):
+    r = {'op': 'submission', 'problem_id': pid, 'status': status}
+    r.update(extra)
+    self.append(r)
+
+  def status(self, pid):
+    self.refresh()
+    return self.entries.get(pid)
+
+  def best(self, pid):
+    e = self.status(pid)
+    if e is None or e['offset'] is None:
+      return None
+    with open(self.log_name, 'rb') as f:
+      f.seek(e['offset'])
+      return json.loads(f.readline().decode('utf-8'))['solution']
+
+  def report(self):
+    self.refresh()
+    es = list(self.entries.values())
+    statuses = {}
+    for e in es:
+      statuses[e['status']] = statuses.get(e['status'], 0) + 1
+    submitted = {}
+    for e in es:
+      if e['submission']:
+        submitted[e['submission']['status']] = submitted.get(e['submission']['status'], 0) + 1
+    return {
+      'problems': len(es),
+      'status': statuses,
+      'submissions': submitted,
+      'solve_time': round(sum(e['solve_time'] for e in es), 4),
+      'solved_size': sum(e['size'] for e in es if e['status'] == 'solved'),
+    }
+
+
+def problem_id(fn):
+  return int(os.path.basename(fn).split('-')[0])
+
+
+def migrate(store, solutions, failed):
+  # the old layout: the solution, then whatever the server said about it
+  n = 0
+  for fn in sorted(glob.glob(os.path.join(solutions, '*-solved.txt'))):
+    with open(fn) as f:
+      lines = f.read().splitlines()
+    tail = [i for i, x in enumerate(lines) if x.startswith('{')]
+    text = '\n'.join(lines[:tail[0]] if tail else lines) + '\n'
+    store.record_solution(problem_id(fn), text, source=fn)
+    for i in tail:
+      try:
+        r = json.loads(lines[i])
+        store.record_submission(problem_id(fn), 'sent' if r.get('ok') else 'failed', hash=text_hash(text),
+          resemblance=r.get('resemblance'), response=r)
+      except ValueError:
+        pass
+    n += 1
+  for fn in sorted(glob.glob(os.path.join(failed, '*-failed.txt'))):
+    store.record_attempt(problem_id(fn), 'failed', source=fn)
+    n += 1
+  return n
+
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(description='append-only results store')
+  parser.add_argument('--store', default=os.environ.get('RESULTS', DEFAULT_STORE))
+  sub = parser.add_subparsers(dest='cmd')
+
+  p = sub.add_parser('put', help='record a solution')
+  p.add_argument('problem_id', type=int)
+  p.add_argument('solution')
+  p.add_argument('--resemblance', type=float, default=1.0)
+  p.add_argument('--wall-time', type=float, default=0)
+
+  p = sub.add_parser('fail', help='record an attempt without a solution')
+  p.add_argument('problem_id', type=int)
+  p.add_argument('--status', default='failed')
+  p.add_argument('--wall-time', type=float, default=0)
+
+  p = sub.add_parser('get', help='print the best solution')
+  p.add_argument('problem_id', type=int)
+
+  p = sub.add_parser('status', help='print the index entry')
+  p.add_argument('problem_id', type=int)
+
+  p = sub.add_parser('pending', help='spec files with nothing recorded yet')
+  p.add_argument('specs', nargs='+')
+
+  p = sub.add_parser('report', help='summary over the whole store')
+
+  p = sub.add_parser('migrate', help='import results/ and failed/ files')
+  p.add_argument('--solutions', default='results')
+  p.add_argument('--failed', default='failed')
+
+  p = sub.add_parser('export', help='write the best solutions as NNNNNN-solved.txt')
+  p.add_argument('where')
+
+  args = parser.parse_args()
+  if args.cmd is None:
+    parser.print_help()
+    sys.exit(2)
+
+  store = Store(args.store)
+  try:
+    if args.cmd == 'put':
+      with open(args.solution) as f:
+        store.record_solution(args.problem_id, f.read(), args.resemblance, args.wall_time)
+    elif args.cmd == 'fail':
+      store.record_attempt(args.problem_id, args.status, args.wall_time)
+    elif args.cmd == 'get':
+      text = store.best(args.problem_id)
+      if text is None:
+        sys.exit(1)
+      sys.stdout.write(text)
+    elif args.cmd == 'status':
+      print(json.dumps(store.status(args.problem_id), sort_keys=True))
+    elif args.cmd == 'pending':
+      for fn in args.specs:
+        e = store.status(problem_id(fn))
+        if e is None or e['status'] == 'new':
+          print(fn)
+    elif args.cmd == 'report':
+      print(json.dumps(store.report(), sort_keys=True))
+    elif args.cmd == 'migrate':
+      print('%d files imported' % migrate(store, args.solutions, args.failed), file=sys.stderr)
+    elif args.cmd == 'export':
+      if not os.path.exists(args.where):
+        os.makedirs(args.where)
+      for pid in sorted(store.entries):
+        text = store.best(pid)
+        if text is not None:
+          with open(os.path.join(args.where, '%06d-solved.txt' % pid), 'w') as f:
+            f.write(text)
+  finally:
+    store.close()
@@ -0,0 +1,336 @@
+#!/usr/bin/env python
+from __future__ import print_function, division
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import outbox
+import results
+import tracing
+
+
+# Corpus run under a global CPU budget, best expected score per CPU-second
+# first. A perfect solution to a problem of size s is worth s/n, n being
+# the number of perfect solvers plus one; n is not in the metadata, so the
+# size stands for the payoff. The chance of solving comes from outcomes
+# observed so far in the problem's owner and size band, smoothed towards
+# the overall rate, and the cost from the time of every attempt observed in
+# the band, whatever its outcome.
+# Bands are over the owner's solution size, the closest thing in the
+# metadata to the number of folds.
+#
+# Every outcome is appended to the log and read back on the next run, so
+# the ranking keeps learning. A search that ran to the end without a
+# solution is not tried again; one cut short, or with only a partial
+# answer, is, with a longer slice.
+
+DEFAULT_PROBLEMS = '../../spec/problems'
+DEFAULT_LOG = 'temp-schedule.jsonl'
+TEAM = '116'
+
+PRIOR_RATE = 0.3
+PRIOR_WEIGHT = 4
+SIZE_BANDS = 8
+
+
+def load_problems(problems, team):
+  res = []
+  for fn in sorted(glob.glob(os.path.join(problems, '*-meta.json'))):
+    with open(fn) as f:
+      meta = json.load(f)
+    spec = os.path.join(problems, '%06d-spec.txt' % meta['problem_id'])
+    # a team cannot solve its own problems
+    if meta.get('owner') == team or not os.path.exists(spec):
+      continue
+    res.append({
+      'problem_id': meta['problem_id'],
+      'problem_size': meta['problem_size'],
+      'solution_size': meta['solution_size'],
+      'owner': meta.get('owner'),
+      'spec': spec,
+    })
+
+  # the owner's solution size says how many folds the problem takes
+  ordered = sorted(p['solution_size'] for p in res)
+  edges = [ordered[len(ordered) * b // SIZE_BANDS] for b in range(1, SIZE_BANDS)] if ordered else []
+  for p in res:
+    p['band'] = sum(1 for e in edges if p['solution_size'] >= e)
+  return res
+
+
+def load_log(fn):
+  res = []
+  if os.path.exists(fn):
+    with open(fn) as f:
+      for line in f:
+        try:
+          res.append(json.loads(line))
+        except ValueError:
+          pass
+  return res
+
+
+class Model:
+  # success counts and solve times per owner and per size band
+
+  def __init__(self):
+    self.tried = {}
+    self.solved = {}
+    self.seconds = {}
+
+  def add(self, p, r):
+    # every attempt costs its time, timeouts and failures included
+    for key in [('owner', p['owner']), ('band', p['band']), ('all', None)]:
+      self.tried[key] = self.tried.get(key, 0) + 1
+      self.seconds[key] = self.seconds.get(key, 0) + r['wall_time']
+      if r['solved']:
+        self.solved[key] = self.solved.get(key, 0) + 1
+
+  def rate(self, key, prior):
+    return (self.solved.get(key, 0) + PRIOR_WEIGHT * prior) / (self.tried.get(key, 0) + PRIOR_WEIGHT)
+
+  def chance(self, p):
+    # before any outcome, fewer folds are the better bet
+    overall = self.rate(('all', None), PRIOR_RATE * (SIZE_BANDS - p['band']) / SIZE_BANDS)
+    return (self.rate(('owner', p['owner']), overall) + self.rate(('band', p['band']), overall)) / 2
+
+  def cost(self, p, default):
+    # expected seconds of an attempt, solved or not
+    key = ('band', p['band'])
+    n = self.tried.get(key, 0)
+    return (self.seconds.get(key, 0) + default) / (n + 1)
+
+  def priority(self, p, default):
+    return self.chance(p) * p['problem_size'] / max(self.cost(p, default), 0.01)
+
+
+class Scheduler:
+
+  def __init__(self, args):
+    self.args = args
+    self.lock = threading.Lock()
+    self.model = Model()
+    self.cpu = args.budget * args.jobs
+    self.started = time.time()
+    self.deadline = self.started + args.budget
+    self.completed = 0
+    self.log = open(args.log, 'a')
+    self.store = results.Store(args.results)
+
+    problems = dict((p['problem_id'], p) for p in load_problems(args.problems, args.team))
+    last = {}
+    for r in load_log(args.log):
+      if r.get('problem_id') in problems:
+        self.model.add(problems[r['problem_id']], r)
+        last[r['problem_id']] = r
+
+    self.queue = []
+    for pid, p in sorted(problems.items()):
+      r = last.get(pid)
+      e = self.store.status(pid)
+      if e is not None and e['status'] == 'solved':
+        continue
+      # a partial answer may yet become exact with a longer slice
+      if r is not None and (r['solved'] or (r['status'] != 'partial' and not r['out_of_time'])):
+        continue
+      p['tried_slice'] = r['slice'] if r else 0
+      self.queue.append(p)
+    self.rerank()
+
+  def rerank(self):
+    default = self.args.max_slice
+    for p in self.queue:
+      p['priority'] = self.model.priority(p, default)
+    self.queue.sort(key=lambda p: (-p['priority'], p['problem_id']))
+    self.total = sum(p['priority'] for p in self.queue)
+
+  def slice_for(self, p):
+    # a share of the remaining CPU in proportion to priority; most searches
+    # end well inside their slice and give the rest back
+    share = self.cpu * p['priority'] / self.total if self.total > 0 else self.args.max_slice
+    return min(max(share, self.args.min_slice), self.args.max_slice, self.deadline - time.time())
+
+  def take(self):
+    with self.lock:
+      while self.queue and self.cpu > 0 and time.time() < self.deadline:
+        p = self.queue.pop(0)
+        self.total -= p['priority']
+        t = self.slice_for(p)
+        # the same search again with no more time would end the same way
+        if t <= p['tried_slice'] or t <= 0:
+          continue
+        self.cpu -= t
+        return p, t
+      return None, 0
+
+  def done(self, p, t, r):
+    with self.lock:
+      solution = r.pop('solution', None)
+      if solution is not None:
+        self.store.record_solution(p['problem_id'], solution, r['resemblance'], r['wall_time'], slice=round(t, 3))
+      else:
+        self.store.record_attempt(p['problem_id'], r['status'], wall_time=r['wall_time'], slice=round(t, 3))
+      self.cpu += t - r['wall_time']
+      self.model.add(p, r)
+      r.update({'problem_id': p['problem_id'], 'problem_size': p['problem_size'], 'slice': round(t, 3),
+        'priority': round(p['priority'], 3), 'time': time.time()})
+      self.log.write(json.dumps(r, sort_keys=True) + '\n')
+      self.log.flush()
+      self.completed += 1
+      if self.completed % self.args.rerank == 0:
+        self.rerank()
+      print('%06d %-7s %7.3fs of %6.3fs  prio %9.1f  cpu left %7.0fs' % (p['problem_id'],
+        r['status'], r['wall_time'], t, p['priority'], self.cpu), file=sys.stderr)
+
+
+def read_stats(text):
+  stats = {}
+  for line in text.splitlines():
+    if line.startswith('{'):
+      try:
+        stats = json.loads(line)
+      except ValueError:
+        pass
+  return stats
+
+
+def solve_one(args, trace, p, t):
+  # the batchsolve pipeline with a time slice: preproc, solve, postproc,
+  # validate, then queue the submission
+  pid = p['problem_id']
+  temp = tempfile.NamedTemporaryFile(prefix='temp-schedule-', suffix='.txt', delete=False)
+  try:
+    with trace.span('preproc', problem_id=pid):
+      temp.write(subprocess.check_output(['./api.py', 'preproc', p['spec']]))
+      temp.close()
+
+    start = time.time()
+    with trace.span('solve', problem_id=pid, slice=round(t, 3)):
+      proc = subprocess.Popen(['timeout', '%.3f' % (t + 0.5), args.solver, '-t', '%.3f' % t, '-p', '-', '-f', temp.name]
+        + tracing.solver_args(trace), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+      out, err = proc.communicate()
+    wall = time.time() - start
+    stats = read_stats(err.decode('utf-8', 'replace'))
+
+    solution = None
+    if proc.returncode == 0 and out:
+      with trace.span('postproc', problem_id=pid):
+        with open(temp.name, 'wb') as f:
+          f.write(out)
+        spec = subprocess.check_output(['./api.py', 'postproc', p['spec'], temp.name])
+        with open(temp.name, 'wb') as f:
+          f.write(spec)
+      validator = os.path.join(os.path.dirname(args.solver), 'validate')
+      with trace.span('validate', problem_id=pid):
+        valid = not os.path.exists(validator) or subprocess.call([validator, '-q', temp.name]) == 0
+      if valid:
+        with trace.span('queue', problem_id=pid):
+          solution = spec.decode('utf-8')
+          outbox.put(args.outbox, pid, solution)
+
+    # silhouettes of several polygons may be covered only in part; only an
+    # exact answer counts as solved
+    resemblance = stats.get('resemblance', 1.0) if solution is not None else 0.0
+    solved = resemblance >= 1
+    out_of_time = bool(proc.returncode == 124 or stats.get('out_of_time'))
+    return {
+      'status': 'solved' if solved else ('partial' if solution is not None else ('timeout' if out_of_time else 'failed')),
+      'solved': solved,
+      'out_of_time': out_of_time,
+      'wall_time': round(wall, 4),
+      'nodes_expanded': stats.get('nodes_expanded'),
+      'resemblance': resemblance,
+      'solution': solution,
+    }
+  finally:
+    os.unlink(temp.name)
+
+
+def run(args):
+  scheduler = Scheduler(args)
+  trace = tracing.open_trace(args.trace)
+  print('%d problems, %.0f CPU seconds on %d jobs' % (len(scheduler.queue), scheduler.cpu, args.jobs), file=sys.stderr)
+
+  def work(name):
+    trace.name_thread(name)
+    while True:
+      with trace.span('take'):
+        p, t = scheduler.take()
+      if p is None:
+        return
+      with trace.span('problem', problem_id=p['problem_id']) as span:
+        try:
+          r = solve_one(args, trace, p, t)
+        except (OSError, subprocess.CalledProcessError) as e:
+          print('%06d %s' % (p['problem_id'], e), file=sys.stderr)
+          r = {'status': 'error', 'solved': False, 'out_of_time': False, 'wall_time': 0}
+        span['status'] = r['status']
+      scheduler.done(p, t, r)
+
+  threads = [threading.Thread(target=work, args=('worker %d' % i,)) for i in range(args.jobs)]
+  for x in threads:
+    x.start()
+  for x in threads:
+    x.join()
+  scheduler.log.close()
+  scheduler.store.close()
+
+  results = [r for r in load_log(args.log) if r.get('time', 0) >= scheduler.started]
+  print(json.dumps({
+    'problems': len(results),
+    'solved': len([r for r in results if r['solved']]),
+    'solved_size': sum(r['problem_size'] for r in results if r['solved']),
+    'cpu_left': round(scheduler.cpu, 1),
+    'remaining': len(scheduler.queue),
+  }, sort_keys=True))
+
+
+def plan(args):
+  scheduler = Scheduler(args)
+  for p in scheduler.queue[:args.top]:
+    print('%06d  size %5d  band %d  owner %-4s  chance %.3f  cost %6.3fs  prio %9.1f  slice %6.3fs' % (
+      p['problem_id'], p['problem_size'], p['band'], p['owner'], scheduler.model.chance(p),
+      scheduler.model.cost(p, args.max_slice), p['priority'], scheduler.slice_for(p)))
+  scheduler.store.close()
+
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(description='value-aware corpus run under a CPU budget')
+  sub = parser.add_subparsers(dest='cmd')
+
+  def options(p):
+    p.add_argument('--problems', default=DEFAULT_PROBLEMS)
+    p.add_argument('--log', default=DEFAULT_LOG, help='outcomes, read back to rank the next run')
+    p.add_argument('--team', default=os.environ.get('TEAM_ID', TEAM))
+    p.add_argument('--budget', type=float, default=1800, help='wall seconds for the whole run')
+    p.add_argument('--jobs', type=int, default=1, help='solver processes at once')
+    p.add_argument('--min-slice', type=float, default=0.5)
+    p.add_argument('--max-slice', type=float, default=30)
+    p.add_argument('--results', default=os.environ.get('RESULTS', results.DEFAULT_STORE), help='results store')
+
+  p = sub.add_parser('run', help='solve the corpus within the budget')
+  options(p)
+  p.add_argument('--solver', default='./solve')
+  p.add_argument('--outbox', default=os.environ.get('OUTBOX', outbox.DEFAULT_OUTBOX))
+  p.add_argument('--rerank', type=int, default=16, help='outcomes between re-rankings')
+  p.add_argument('--trace', help='append trace events to this file, default $TRACE')
+
+  p = sub.add_parser('plan', help='print the ranking without solving')
+  options(p)
+  p.add_argument('--top', type=int, default=40)
+
+  args = parser.parse_args()
+
+  if args.cmd == 'run':
+    run(args)
+  elif args.cmd == 'plan':
+    plan(args)
+  else:
+    parser.print_help()
+    sys.exit(2)
@@ -7,6 +7,7 @@ if [ "$1" = "" ]; then
 fi
 
 SOLVER="../build/solve"
+VALIDATOR="../build/validate"
 PROBLEMS="../../spec/problems/rounded"
 SOLUTIONS="results"
 
@@ -19,5 +20,6 @@ TEMPFILE="$PROB-failed.txt"
 OUTFILE="$SOLUTIONS/$PROB-solved.txt"
 
 "$SOLVER" -f "$PROBLEMS/$PROB-rounded.txt" | tee "$TEMPFILE"
+"$VALIDATOR" -q "$TEMPFILE"
 
 ./api.py submit "$problemId" "$TEMPFILE" && mv "$TEMPFILE" "$OUTFILE"
@@ -0,0 +1,382 @@
+#!/usr/bin/env python
+from __future__ import print_function, division
+import argparse
+import glob
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+try:
+  import socketserver
+except ImportError:
+  import SocketServer as socketserver
+
+import outbox
+import results
+import tracing
+from daemon import SolverServer, last_stats
+
+
+# Corpus sweep spread over workers on any number of hosts. The coordinator
+# leases problem ids to workers over TCP (HOST:PORT) or a Unix socket (a
+# path), one JSON object per line each way:
+#
+#   {"op": "lease", "worker": W, "count": N}    -> {"problems": [{"problem_id", "spec"}], "lease": S}
+#                                                  {"wait": S} or {"done": true}
+#   {"op": "renew", "worker": W, "ids": [...]}  -> {"ok": true}
+#   {"op": "result", "worker": W, "result": R}  -> {"ok": true}
+#
+# Specs travel with the lease, so workers need no shared filesystem. A
+# worker runs them through the batchsolve pipeline, preproc, solve,
+# postproc and validate, and sends back the solution in contest form. A
+# lease not renewed in time goes back to the queue for another worker; the
+# first result for a problem wins. Outcomes go to the results store, see
+# results.py, and solutions to the outbox when one is given; the sweep's
+# own records are appended to a JSONL file as they come in, and a
+# restarted coordinator skips the problems found there.
+
+DEFAULT_PROBLEMS = '../../spec/problems'
+
+
+def parse_address(address):
+  if '/' in address:
+    return socket.AF_UNIX, address
+  host, port = address.rsplit(':', 1)
+  return socket.AF_INET, (host, int(port))
+
+
+class Coordinator:
+
+  def __init__(self, args):
+    self.args = args
+    self.lock = threading.Lock()
+    self.leased = {}
+    self.attempts = {}
+    self.done = set()
+    self.finished = threading.Event()
+
+    if os.path.exists(args.results):
+      with open(args.results) as f:
+        for line in f:
+          try:
+            self.done.add(json.loads(line)['problem_id'])
+          except (ValueError, KeyError):
+            pass
+
+    self.specs = {}
+    for fn in sorted(glob.glob(os.path.join(args.problems, '*-spec.txt'))):
+      pid = int(os.path.basename(fn).split('-')[0])
+      if args.first <= pid <= (args.last or pid) and pid not in self.done:
+        self.specs[pid] = fn
+    self.pending = sorted(self.specs)
+    self.out = open(args.results, 'a')
+    self.store = results.Store(args.store)
+    print('%d problems to sweep, %d already done' % (len(self.pending), len(self.done)), file=sys.stderr)
+    if not self.pending:
+      self.finished.set()
+
+  def expire(self, now):
+    lapsed = sorted(pid for pid, (worker, until) in self.leased.items() if until < now)
+    for pid in lapsed:
+      print('%06d lease of %s expired' % (pid, self.leased.pop(pid)[0]), file=sys.stderr)
+    self.pending[:0] = lapsed
+
+  def lease(self, req):
+    with self.lock:
+      now = time.time()
+      self.expire(now)
+      if not self.pending:
+        if not self.leased:
+          self.finished.set()
+          return {'done': True}
+        return {'wait': min(self.args.lease, 1.0)}
+
+      ids = self.pending[:max(1, req.get('count', 1))]
+      del self.pending[:len(ids)]
+      problems = []
+      for pid in ids:
+        self.leased[pid] = (req['worker'], now + self.args.lease)
+        self.attempts[pid] = self.attempts.get(pid, 0) + 1
+        with open(self.specs[pid]) as f:
+          problems.append({'problem_id': pid, 'spec': f.read()})
+      return {'problems': problems, 'lease': self.args.lease}
+
+  def renew(self, req):
+    with self.lock:
+      until = time.time() + self.args.lease
+      for pid in req.get('ids', []):
+        if pid in self.leased and self.leased[pid][0] == req['worker']:
+          self.leased[pid] = (req['worker'], until)
+      return {'ok': True}
+
+  def result(self, req):
+    r = req['result']
+    pid = r['problem_id']
+    with self.lock:
+      if pid in self.done:
+        return {'ok': True, 'duplicate': True}
+      self.done.add(pid)
+      self.leased.pop(pid, None)
+      if pid in self.pending:
+        self.pending.remove(pid)
+
+      r['worker'] = req['worker']
+      r['attempts'] = self.attempts.get(pid, 1)
+      solution = r.pop('solution', None)
+      if solution:
+        self.store.record_solution(pid, solution, r['resemblance'], r['wall_time'], worker=r['worker'])
+        if self.args.outbox:
+          outbox.put(self.args.outbox, pid, solution)
+      else:
+        self.store.record_attempt(pid, r['status'], wall_time=r['wall_time'], worker=r['worker'])
+      self.out.write(json.dumps(r, sort_keys=True) + '\n')
+      self.out.flush()
+      print('%06d %-7s %8.3fs  %s' % (pid, r['status'], r['wall_time'], req['worker']), file=sys.stderr)
+      return {'ok': True}
+
+  def handle(self, req):
+    op = req.get('op')
+    if op == 'lease':
+      return self.lease(req)
+    if op == 'renew':
+      return self.renew(req)
+    if op == 'result':
+      return self.result(req)
+    return {'error': 'unknown op %r' % op}
+
+
+def summarize(fn):
+  results = []
+  with open(fn) as f:
+    for line in f:
+      try:
+        results.append(json.loads(line))
+      except ValueError:
+        pass
+  solved = [r for r in results if r['status'] == 'solved']
+  workers = {}
+  for r in results:
+    workers[r['worker']] = workers.get(r['worker'], 0) + 1
+  return {
+    'problems': len(results),
+    'solved': len(solved),
+    'partial': len([r for r in results if r['status'] == 'partial']),
+    'wall_time': round(sum(r['wall_time'] for r in results), 4),
+    'nodes_expanded': sum((r.get('stats') or {}).get('nodes_expanded', 0) for r in results),
+    'reassigned': len([r for r in results if r.get('attempts', 1) > 1]),
+    'workers': workers,
+  }
+
+
+def coordinate(args):
+  coordinator = Coordinator(args)
+
+  class Handler(socketserver.StreamRequestHandler):
+    def handle(self):
+      for line in self.rfile:
+        try:
+          res = coordinator.handle(json.loads(line.decode('utf-8')))
+        except (ValueError, KeyError) as e:
+          res = {'error': str(e)}
+        self.wfile.write((json.dumps(res) + '\n').encode('utf-8'))
+        self.wfile.flush()
+
+  family, address = parse_address(args.listen)
+  if family == socket.AF_UNIX:
+    if os.path.exists(address):
+      os.unlink(address)
+    server = socketserver.ThreadingUnixStreamServer(address, Handler)
+  else:
+    socketserver.ThreadingTCPServer.allow_reuse_address = True
+    server = socketserver.ThreadingTCPServer(address, Handler)
+  server.daemon_threads = True
+
+  thread = threading.Thread(target=server.serve_forever)
+  thread.daemon = True
+  thread.start()
+
+  # let the workers hear "done" before the socket goes away
+  while not coordinator.finished.wait(1.0):
+    pass
+  time.sleep(args.linger)
+  server.shutdown()
+  server.server_close()
+  coordinator.out.close()
+  coordinator.store.close()
+  print(json.dumps(summarize(args.results), sort_keys=True))
+
+
+class Connection:
+
+  def __init__(self, address):
+    family, addr = parse_address(address)
+    self.sock = socket.socket(family, socket.SOCK_STREAM)
+    self.sock.connect(addr)
+    self.rfile = self.sock.makefile('rb')
+    self.lock = threading.Lock()
+
+  def call(self, req):
+    with self.lock:
+      self.sock.sendall((json.dumps(req) + '\n').encode('utf-8'))
+      line = self.rfile.readline()
+    if not line:
+      raise IOError('coordinator closed the connection')
+    return json.loads(line.decode('utf-8'))
+
+
+def solve_one(args, solver, stats_name, offset, trace, p):
+  # the spec through preproc, the resident solver, postproc and validate;
+  # the solution in contest form, or None
+  pid = p['problem_id']
+  spec = tempfile.NamedTemporaryFile(prefix='temp-sweep-', suffix='.txt', delete=False)
+  temp = tempfile.NamedTemporaryFile(prefix='temp-sweep-', suffix='.txt', delete=False)
+  try:
+    spec.write(p['spec'].encode('ascii'))
+    spec.close()
+    temp.close()
+    with trace.span('preproc', problem_id=pid):
+      prepped = subprocess.check_output(['./api.py', 'preproc', spec.name])
+
+    start = time.time()
+    with trace.span('solve', problem_id=pid):
+      out = solver.solve(prepped)
+    wall = time.time() - start
+    stats, offset = last_stats(stats_name, offset)
+
+    solution = None
+    if out:
+      with trace.span('postproc', problem_id=pid):
+        with open(temp.name, 'w') as f:
+          f.write(out)
+        text = subprocess.check_output(['./api.py', 'postproc', spec.name, temp.name])
+        with open(temp.name, 'wb') as f:
+          f.write(text)
+      validator = os.path.join(os.path.dirname(args.solver), 'validate')
+      with trace.span('validate', problem_id=pid):
+        if not os.path.exists(validator) or subprocess.call([validator, '-q', temp.name]) == 0:
+          solution = text.decode('utf-8')
+
+    # a silhouette of several polygons may get a partial answer
+    resemblance = (stats or {}).get('resemblance', 1.0) if solution else 0.0
+    return {
+      'problem_id': pid,
+      'status': 'solved' if resemblance >= 1 else ('partial' if solution else 'failed'),
+      'resemblance': resemblance,
+      'wall_time': round(wall, 4),
+      'stats': stats,
+      'solution': solution,
+    }, offset
+  finally:
+    os.unlink(spec.name)
+    os.unlink(temp.name)
+
+
+def work_loop(args, name, trace):
+  trace.name_thread(name)
+  conn = Connection(args.connect)
+  stats_file = tempfile.NamedTemporaryFile(prefix='temp-sweep-', delete=False)
+  stats_file.close()
+  solver_args = ['-t', str(args.time_limit), '-p', stats_file.name] + tracing.solver_args(trace) + args.solver_args.split()
+  solver = SolverServer(args.solver, solver_args)
+
+  held = []
+  offset = 0
+  stop = threading.Event()
+
+  def heartbeat():
+    while not stop.wait(args.renew):
+      if held:
+        try:
+          conn.call({'op': 'renew', 'worker': name, 'ids': list(held)})
+        except (IOError, OSError, ValueError):
+          return
+  beat = threading.Thread(target=heartbeat)
+  beat.daemon = True
+  beat.start()
+
+  try:
+    while True:
+      with trace.span('lease'):
+        res = conn.call({'op': 'lease', 'worker': name, 'count': args.batch})
+      if res.get('done'):
+        break
+      if 'wait' in res:
+        with trace.span('wait'):
+          time.sleep(res['wait'])
+        continue
+
+      held[:] = [p['problem_id'] for p in res['problems']]
+      for p in res['problems']:
+        with trace.span('problem', problem_id=p['problem_id']):
+          try:
+            r, offset = solve_one(args, solver, stats_file.name, offset, trace, p)
+          except subprocess.CalledProcessError as e:
+            print('%06d %s' % (p['problem_id'], e), file=sys.stderr)
+            r = {'problem_id': p['problem_id'], 'status': 'error', 'resemblance': 0.0, 'wall_time': 0}
+        with trace.span('result', problem_id=p['problem_id']):
+          conn.call({'op': 'result', 'worker': name, 'result': r})
+        held.remove(p['problem_id'])
+  except (IOError, OSError) as e:
+    print('%s: %s' % (name, e), file=sys.stderr)
+  finally:
+    stop.set()
+    solver.close()
+    os.unlink(stats_file.name)
+
+
+def work(args):
+  host = socket.gethostname()
+  trace = tracing.open_trace(args.trace)
+  threads = []
+  for i in range(args.jobs):
+    t = threading.Thread(target=work_loop, args=(args, '%s:%d:%d' % (host, os.getpid(), i), trace))
+    t.start()
+    threads.append(t)
+  for t in threads:
+    t.join()
+
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(description='corpus sweep over leased workers')
+  sub = parser.add_subparsers(dest='cmd')
+
+  p = sub.add_parser('coordinator', help='lease problems and collect results')
+  p.add_argument('--listen', default='127.0.0.1:8017', help='HOST:PORT or a Unix socket path')
+  p.add_argument('--problems', default=DEFAULT_PROBLEMS)
+  p.add_argument('--first', type=int, default=0)
+  p.add_argument('--last', type=int, default=0)
+  p.add_argument('--lease', type=float, default=30, help='seconds a lease lasts without renewal')
+  p.add_argument('--results', default='temp-sweep-results.jsonl')
+  p.add_argument('--store', default=os.environ.get('RESULTS', results.DEFAULT_STORE), help='results store')
+  p.add_argument('--outbox', help='queue the solutions for submission there, see outbox.py')
+  p.add_argument('--linger', type=float, default=2)
+
+  p = sub.add_parser('worker', help='solve leased problems')
+  p.add_argument('--connect', default='127.0.0.1:8017')
+  p.add_argument('--solver', default='./solve')
+  p.add_argument('--solver-args', default='')
+  p.add_argument('--time-limit', type=float, default=4.5)
+  p.add_argument('--jobs', type=int, default=1, help='solver processes on this host')
+  p.add_argument('--batch', type=int, default=1, help='problems per lease')
+  p.add_argument('--renew', type=float, default=5, help='seconds between lease renewals')
+  p.add_argument('--trace', help='append trace events to this file, default $TRACE')
+
+  p = sub.add_parser('summary', help='summarize a results file')
+  p.add_argument('results')
+
+  args = parser.parse_args()
+
+  if args.cmd == 'coordinator':
+    coordinate(args)
+  elif args.cmd == 'worker':
+    work(args)
+  elif args.cmd == 'summary':
+    print(json.dumps(summarize(args.results), sort_keys=True))
+  else:
+    parser.print_help()
+    sys.exit(2)
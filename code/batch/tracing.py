@@ -0,0 +1,76 @@
+from __future__ import print_function, division
+import contextlib
+import fcntl
+import json
+import os
+import threading
+import time
+
+
+# Span events in the Chrome trace event format, appended to the same file
+# the solver writes with -e, one event per line:
+#
+#   [
+#   {"name": "solve", "cat": "batch", "ph": "X", "ts": ..., "dur": ..., "pid": ..., "tid": ..., "args": {...}},
+#
+# Load it in chrome://tracing or ui.perfetto.dev; the closing bracket is
+# optional there. Timestamps are microseconds since the epoch, the same
+# clock the solver uses. Tracing is on when TRACE names a file.
+
+
+def now():
+  return int(time.time() * 1e6)
+
+
+class Trace:
+
+  def __init__(self, fn):
+    self.fn = fn
+    self.fd = os.open(fn, os.O_WRONLY | os.O_APPEND | os.O_CREAT, 0o644)
+    fcntl.flock(self.fd, fcntl.LOCK_EX)
+    if os.fstat(self.fd).st_size == 0:
+      os.write(self.fd, b'[\n')
+    fcntl.flock(self.fd, fcntl.LOCK_UN)
+
+  def write(self, event):
+    event['pid'] = os.getpid()
+    event['tid'] = threading.current_thread().ident
+    os.write(self.fd, (json.dumps(event, sort_keys=True) + ',\n').encode('utf-8'))
+
+  def complete(self, name, cat, start, **args):
+    self.write({'name': name, 'cat': cat, 'ph': 'X', 'ts': start, 'dur': now() - start, 'args': args})
+
+  @contextlib.contextmanager
+  def span(self, name, cat='batch', **args):
+    start = now()
+    try:
+      yield args
+    finally:
+      self.complete(name, cat, start, **args)
+
+  def name_thread(self, name):
+    self.write({'name': 'thread_name', 'ph': 'M', 'args': {'name': name}})
+
+
+class NoTrace:
+
+  fn = None
+
+  @contextlib.contextmanager
+  def span(self, name, cat='batch', **args):
+    yield args
+
+  def complete(self, name, cat, start, **args):
+    pass
+
+  def name_thread(self, name):
+    pass
+
+
+def open_trace(fn=None):
+  fn = fn or os.environ.get('TRACE')
+  return Trace(os.path.abspath(fn)) if fn else NoTrace()
+
+
+def solver_args(trace):
+  return ['-e', trace.fn] if trace.fn else []
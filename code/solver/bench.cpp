@@ -0,0 +1,244 @@
+#include "unity.cpp"
+
+#include <dirent.h>
+
+typedef struct bench_settings_t
+{
+  string problems;
+  string submissions;
+  u32 fixtures;
+  u32 samples;
+  r64 sample_time;
+  bool print_usage_and_exit;
+} bench_settings;
+
+
+static bench_settings
+parse_bench_settings(int argc, char* argv[])
+{
+  int c;
+  int errflg = 0;
+  bench_settings Settings = {};
+  Settings.fixtures = 10;
+  Settings.samples = 15;
+  Settings.sample_time = 0.01;
+
+  while ((c = getopt(argc, argv, "p:s:n:r:t:h")) != -1)
+  {
+    switch (c)
+    {
+      case 'p':
+        Settings.problems = optarg;
+        break;
+
+      case 's':
+        Settings.submissions = optarg;
+        break;
+
+      case 'n':
+        Settings.fixtures = atoi(optarg);
+        break;
+
+      case 'r':
+        Settings.samples = atoi(optarg);
+        break;
+
+      case 't':
+        Settings.sample_time = atof(optarg);
+        break;
+
+      case '?':
+      case 'h':
+        errflg++;
+        break;
+    }
+  }
+
+  if (errflg > 0 || (Settings.problems.empty() && Settings.submissions.empty())
+    || Settings.samples == 0)
+  {
+    Settings.print_usage_and_exit = true;
+  }
+
+  return Settings;
+}
+
+
+// Sorted so the fixture set is stable from run to run.
+static vector<string>
+list_fixtures(const string& dir, const string& suffix, u32 limit)
+{
+  vector<string> res;
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr)
+    return res;
+
+  while (auto* ent = readdir(d)) {
+    string name = ent->d_name;
+    if (name.size() > suffix.size()
+      && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+      res.push_back(dir + "/" + name);
+  }
+  closedir(d);
+
+  sort(begin(res), end(res));
+  if (res.size() > limit)
+    res.resize(limit);
+  return res;
+}
+
+
+typedef chrono::steady_clock bench_clock;
+
+static volatile size_t bench_sink;
+
+// Calibrates the iteration count so one sample takes at least sample_time
+// seconds, then reports per-call statistics over all samples in ns.
+static void
+run_bench(const bench_settings& Settings, const string& name, const string& fixture,
+  const function<size_t()>& op)
+{
+  u64 iterations = 1;
+  for (;;) {
+    auto start = bench_clock::now();
+    for (u64 i = 0; i < iterations; i++)
+      bench_sink = bench_sink + op();
+    chrono::duration<r64> elapsed = bench_clock::now() - start;
+    if (elapsed.count() >= Settings.sample_time || iterations >= (1ull << 30))
+      break;
+    iterations *= 2;
+  }
+
+  vector<r64> ns;
+  for (u32 s = 0; s < Settings.samples; s++) {
+    auto start = bench_clock::now();
+    for (u64 i = 0; i < iterations; i++)
+      bench_sink = bench_sink + op();
+    chrono::duration<r64, nano> elapsed = bench_clock::now() - start;
+    ns.push_back(elapsed.count() / iterations);
+  }
+
+  sort(begin(ns), end(ns));
+  auto median = [] (const vector<r64>& xs) {
+    auto n = xs.size();
+    return n % 2 ? xs[n / 2] : (xs[n / 2 - 1] + xs[n / 2]) / 2;
+  };
+
+  r64 mean = 0;
+  for (auto x : ns)
+    mean += x;
+  mean /= ns.size();
+
+  r64 var = 0;
+  for (auto x : ns)
+    var += (x - mean) * (x - mean);
+  r64 stddev = ns.size() > 1 ? sqrt(var / (ns.size() - 1)) : 0;
+
+  auto med = median(ns);
+  vector<r64> dev;
+  for (auto x : ns)
+    dev.push_back(fabs(x - med));
+  sort(begin(dev), end(dev));
+
+  auto slash = fixture.rfind('/');
+  cout << "{\"bench\":\"" << name << "\""
+    << ",\"fixture\":\"" << (slash == string::npos ? fixture : fixture.substr(slash + 1)) << "\""
+    << ",\"isa\":\"" << kernels::active.isa << "\""
+    << ",\"iterations\":" << iterations
+    << ",\"samples\":" << ns.size()
+    << ",\"min_ns\":" << ns.front()
+    << ",\"median_ns\":" << med
+    << ",\"mean_ns\":" << mean
+    << ",\"stddev_ns\":" << stddev
+    << ",\"mad_ns\":" << median(dev)
+    << ",\"max_ns\":" << ns.back()
+    << "}" << endl;
+}
+
+
+static void
+bench_graph(const bench_settings& Settings, const string& fixture, const Graph& graph)
+{
+  if (graph.isempty())
+    return;
+
+  run_bench(Settings, "Graph::outline", fixture, [&graph] () {
+    return graph.outline().front().size();
+  });
+
+  run_bench(Settings, "Graph::hashcode", fixture, [&graph] () {
+    return graph.hashcode();
+  });
+
+  auto axis = graph.edges().front();
+  run_bench(Settings, "Graph::copy_flip", fixture, [&graph, &axis] () {
+    return graph.copy_flip(axis).size();
+  });
+}
+
+static void
+bench_problem(const bench_settings& Settings, string& fixture)
+{
+  run_bench(Settings, "read_problem", fixture, [&fixture] () {
+    return read_problem(0, fixture).outline.size();
+  });
+
+  auto prob = read_problem(0, fixture);
+  search_state state = {};
+  state.origami = Origami::from(prob.outline, prob.skeleton);
+  if (state.origami.isempty())
+    return;
+
+  run_bench(Settings, "search_state::children", fixture, [&state] () {
+    return state.children().size();
+  });
+
+  // a single facet says little about the graph code, go one fold deeper
+  auto children = state.children();
+  bench_graph(Settings, fixture, children.empty() ? state.origami.graph : children.front().origami.graph);
+}
+
+static void
+bench_submission(const bench_settings& Settings, string& fixture)
+{
+  auto sol = read_solution(0, fixture);
+
+  vector<shape> facets;
+  for (auto& refs : sol.facets) {
+    path fig;
+    for (auto i : refs)
+      fig.push_back(sol.vertices[i]);
+    facets.push_back(shape(poly_cast<fraction>(fig)));
+  }
+
+  Graph graph(move(facets));
+  graph.link();
+
+  bench_graph(Settings, fixture, graph);
+}
+
+
+int main(int argc, char* argv[])
+{
+  bench_settings Settings = parse_bench_settings(argc, argv);
+
+  if (Settings.print_usage_and_exit)
+  {
+    cerr << "usage: bench [OPTIONS]\n"
+      "	-p	DIR	Problem fixtures (*-spec.txt)\n"
+      "	-s	DIR	Solution fixtures (*.txt)\n"
+      "	-n	COUNT	Fixtures per directory, default 10\n"
+      "	-r	COUNT	Samples per benchmark, default 15\n"
+      "	-t	SECONDS	Minimum sample time, default 0.01\n"
+    << endl;
+    return 2;
+  }
+
+  for (auto& fn : list_fixtures(Settings.problems, "-spec.txt", Settings.fixtures))
+    bench_problem(Settings, fn);
+
+  for (auto& fn : list_fixtures(Settings.submissions, ".txt", Settings.fixtures))
+    bench_submission(Settings, fn);
+
+  return 0;
+}
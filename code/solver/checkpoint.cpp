@@ -0,0 +1,247 @@
+
+namespace paiv {
+
+// Search checkpoint, the state a timed out search leaves for the next run.
+//
+//   header    magic "SCP1", coordinate size (0x108 for fixed point, to
+//             tell it from double), start state hash, nodes expanded and
+//             seconds spent over all runs, table sizes
+//   sources   vertex count, then r64 x and y of every silhouette region
+//   states    the fringe in queue order: paper area, bounds, redundant
+//             axis flags, and per facet its source, transform and the
+//             facet each edge is linked to (-1 for none)
+//   seen      hashes of every state visited so far
+//
+// Facets keep only what they were placed with, so the restored sheet is
+// the same one, bit for bit. Everything is host byte order.
+
+typedef struct checkpoint_header {
+  char magic[4];
+  u32 precision;
+  u64 problem;
+  u64 expanded;
+  r64 seconds;
+  u64 sources;
+  u64 states;
+  u64 seen;
+} checkpoint_header;
+
+static const char CheckpointMagic[4] = { 'S', 'C', 'P', '1' };
+
+template <typename F>
+static u32
+checkpoint_precision()
+{
+  return is_same<F, q32>::value ? 0x100 | sizeof(F) : sizeof(F);
+}
+
+template <typename F>
+struct checkpoint_t {
+  u64 problem;
+  u64 expanded;
+  r64 seconds;
+  vector<search_state_t<F>> fringe;
+  unordered_set<u64> seen;
+};
+
+
+typedef struct checkpoint_writer {
+  string data;
+
+  template <typename T>
+  void put(const T& x) {
+    data.append((const char*) &x, sizeof(x));
+  }
+
+  template <typename T>
+  void put(const vector<T>& xs) {
+    data.append((const char*) xs.data(), xs.size() * sizeof(T));
+  }
+} checkpoint_writer;
+
+typedef struct checkpoint_reader {
+  const string& data;
+  size_t at;
+
+  template <typename T>
+  u8 get(T& x) {
+    if (data.size() - at < sizeof(x))
+      return false;
+    memcpy(&x, data.data() + at, sizeof(x));
+    at += sizeof(x);
+    return true;
+  }
+
+  template <typename T>
+  u8 get(vector<T>& xs, size_t n) {
+    if ((data.size() - at) / sizeof(T) < n)
+      return false;
+    xs.resize(n);
+    memcpy(xs.data(), data.data() + at, n * sizeof(T));
+    at += n * sizeof(T);
+    return true;
+  }
+} checkpoint_reader;
+
+
+// The file is replaced in one rename, a crash mid-write keeps the last one.
+template <typename F, typename States, typename Hashes>
+static u8
+write_checkpoint(const string& fn, const checkpoint_t<F>& head, const States& states, const Hashes& seen)
+{
+  unordered_map<const coords*, u32> sources;
+  checkpoint_writer body;
+
+  for (const search_state_t<F>* state : states) {
+    auto& facets = state->origami.graph.facets();
+    for (auto& fig : facets)
+      sources.emplace(fig.source.get(), (u32) sources.size());
+  }
+
+  vector<const coords*> table(sources.size());
+  for (auto& it : sources)
+    table[it.second] = it.first;
+  for (auto* src : table) {
+    body.put((u32) src->size());
+    body.put(src->x);
+    body.put(src->y);
+  }
+
+  for (const search_state_t<F>* state : states) {
+    auto& o = state->origami;
+    auto& facets = o.graph.facets();
+    body.put((u32) facets.size());
+    body.put(o.area);
+    body.put(o.box);
+    body.put((u32) state->redundant.size());
+    body.put(state->redundant);
+    for (auto& fig : facets) {
+      body.put(sources[fig.source.get()]);
+      body.put(fig.transform);
+      for (auto& g : fig.edges)
+        body.put((s32) (g.neighbor == nullptr ? -1 : g.neighbor - facets.data()));
+    }
+  }
+
+  u64 count = 0;
+  for (auto h : seen) {
+    body.put((u64) h);
+    count++;
+  }
+
+  checkpoint_header header = {};
+  copy(begin(CheckpointMagic), end(CheckpointMagic), header.magic);
+  header.precision = checkpoint_precision<F>();
+  header.problem = head.problem;
+  header.expanded = head.expanded;
+  header.seconds = head.seconds;
+  header.sources = table.size();
+  header.states = states.size();
+  header.seen = count;
+
+  string temp = fn + ".tmp";
+  {
+    ofstream fout(temp, ofstream::binary | ofstream::trunc);
+    fout.write((const char*) &header, sizeof(header));
+    fout.write(body.data.data(), body.data.size());
+    if (!fout.good())
+      return false;
+  }
+  return rename(temp.c_str(), fn.c_str()) == 0;
+}
+
+// False when there is no checkpoint for this problem at this precision,
+// or it does not parse; the search then starts over.
+template <typename F>
+static u8
+read_checkpoint(const string& fn, u64 problem, checkpoint_t<F>& res)
+{
+  typedef shape_t<F> shape;
+  typedef Graph_t<F> Graph;
+  typedef Origami_t<F> Origami;
+
+  ifstream fin(fn, ifstream::binary);
+  if (!fin.good())
+    return false;
+  string data((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+
+  checkpoint_reader in = { data, 0 };
+  checkpoint_header header;
+  if (!in.get(header)
+    || !equal(begin(CheckpointMagic), end(CheckpointMagic), header.magic)
+    || header.precision != checkpoint_precision<F>() || header.problem != problem)
+    return false;
+
+  vector<shared_ptr<const coords>> sources;
+  for (u64 i = 0; i < header.sources; i++) {
+    u32 n;
+    coords src;
+    if (!in.get(n) || !in.get(src.x, n) || !in.get(src.y, n))
+      return false;
+    sources.push_back(make_shared<const coords>(move(src)));
+  }
+
+  checkpoint_t<F> loaded = {};
+  for (u64 i = 0; i < header.states; i++) {
+    u32 count, flags;
+    r64 area;
+    bbox box;
+    search_state_t<F> state;
+    if (!in.get(count) || !in.get(area) || !in.get(box)
+      || !in.get(flags) || !in.get(state.redundant, flags))
+      return false;
+
+    // links point into the vector, which keeps its buffer when moved
+    vector<shape> facets;
+    vector<s32> links;
+    facets.reserve(count);
+    for (u32 k = 0; k < count; k++) {
+      u32 index;
+      matrix3d transform;
+      if (!in.get(index) || index >= sources.size() || !in.get(transform))
+        return false;
+
+      auto& src = *sources[index];
+      vector<s32> edges;
+      if (!in.get(edges, src.size()))
+        return false;
+      links.insert(end(links), begin(edges), end(edges));
+
+      typename shape::poly fig;
+      for (size_t j = 0; j < src.size(); j++)
+        fig.push_back({ (F) src.x[j], (F) src.y[j] });
+      facets.emplace_back(fig);
+      facets.back().source = sources[index];
+      facets.back().place(transform);
+    }
+
+    size_t j = 0;
+    for (auto& fig : facets) {
+      for (auto& g : fig.edges) {
+        auto link = links[j++];
+        if (link >= (s32) count)
+          return false;
+        g.neighbor = link < 0 ? nullptr : &facets[link];
+      }
+    }
+
+    state.origami = Origami(Graph(move(facets)), area, box);
+    state.terminal = state.isterminal();
+    loaded.fringe.push_back(move(state));
+  }
+
+  for (u64 i = 0; i < header.seen; i++) {
+    u64 h;
+    if (!in.get(h))
+      return false;
+    loaded.seen.insert(h);
+  }
+
+  loaded.problem = header.problem;
+  loaded.expanded = header.expanded;
+  loaded.seconds = header.seconds;
+  res = move(loaded);
+  return true;
+}
+
+}
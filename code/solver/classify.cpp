@@ -0,0 +1,163 @@
+
+namespace paiv {
+
+// Cheap look at a problem before any search, deciding whether the search
+// can represent it at all and how much time it deserves.
+
+typedef enum problem_shape {
+  ShapeDegenerate,
+  ShapeSquare,
+  ShapeRotatedSquare,
+  ShapeRectangle,
+  ShapeConvex,
+  ShapeConcave,
+  ShapeMultiPolygon,
+} problem_shape;
+
+typedef struct problem_class {
+  problem_shape shape;
+  u32 corners;
+  u32 segments;
+  u32 creases;
+  r64 area;
+  r64 magnitude;
+} problem_class;
+
+typedef struct route {
+  u8 search;
+  r64 budget;
+  const char* reason;
+} route;
+
+static const r64 ClassifyTolerance = 0.00001;
+
+// Beyond this the double mantissa no longer separates vertices by the
+// search tolerance.
+static const r64 MaxMagnitude = ClassifyTolerance / 1e-15;
+
+// Skeletons with creases inside the silhouette are searched as a single
+// facet, which rarely folds back; they get a short look only.
+static const r64 ComplexSkeletonSeconds = 1;
+
+static const char*
+shape_name(problem_shape shape)
+{
+  switch (shape) {
+    case ShapeDegenerate: return "degenerate";
+    case ShapeSquare: return "square";
+    case ShapeRotatedSquare: return "rotated square";
+    case ShapeRectangle: return "rectangle";
+    case ShapeConvex: return "convex";
+    case ShapeConcave: return "concave";
+    case ShapeMultiPolygon: return "multi polygon";
+  }
+  return "";
+}
+
+// Turn direction at every corner, measured from the first vertex so huge
+// offsets do not cancel the cross products away.
+static u8
+is_convex(const path& fig)
+{
+  auto& o = fig.front();
+  s32 sign = 0;
+  for (size_t i = 0; i < fig.size(); i++) {
+    auto& a = fig[i];
+    auto& b = fig[(i + 1) % fig.size()];
+    auto& c = fig[(i + 2) % fig.size()];
+    auto t = ((b.x - o.x) - (a.x - o.x)) * ((c.y - o.y) - (b.y - o.y))
+      - ((b.y - o.y) - (a.y - o.y)) * ((c.x - o.x) - (b.x - o.x));
+    if (fabs(t) < ClassifyTolerance * ClassifyTolerance)
+      continue;
+    s32 s = t > 0 ? 1 : -1;
+    if (sign != 0 && s != sign)
+      return false;
+    sign = s;
+  }
+  return true;
+}
+
+// Four corners, all right angles.
+static u8
+is_rectangle(const path& fig)
+{
+  if (fig.size() != 4)
+    return false;
+  for (size_t i = 0; i < 4; i++) {
+    auto& a = fig[i];
+    auto& b = fig[(i + 1) % 4];
+    auto& c = fig[(i + 2) % 4];
+    auto dot = (b.x - a.x) * (c.x - b.x) + (b.y - a.y) * (c.y - b.y);
+    if (!near(dot, 0, ClassifyTolerance))
+      return false;
+  }
+  return true;
+}
+
+static problem_class
+classify(const problem& prob)
+{
+  problem_class res = {};
+  res.segments = prob.skeleton.size();
+  res.magnitude = prob.magnitude;
+  for (auto& fig : prob.outline)
+    res.corners += fig.size();
+
+  if (prob.outline.size() > 1) {
+    res.shape = ShapeMultiPolygon;
+    return res;
+  }
+  if (prob.outline.size() == 0 || prob.outline.front().size() < 3) {
+    res.shape = ShapeDegenerate;
+    return res;
+  }
+
+  auto& fig = prob.outline.front();
+  path local;
+  for (auto& v : fig)
+    local.push_back({ v.x - fig.front().x, v.y - fig.front().y });
+  res.area = area(local);
+  res.creases = res.segments > res.corners ? res.segments - res.corners : 0;
+
+  if (res.area < ClassifyTolerance)
+    res.shape = ShapeDegenerate;
+  else if (!is_convex(local))
+    res.shape = ShapeConcave;
+  else if (!is_rectangle(local))
+    res.shape = ShapeConvex;
+  else if (!near(res.area, 1, ClassifyTolerance) || !near(perimeter(local), 4, ClassifyTolerance))
+    res.shape = ShapeRectangle;
+  else if (near(local[1].x, 0, ClassifyTolerance) || near(local[1].y, 0, ClassifyTolerance))
+    res.shape = ShapeSquare;
+  else
+    res.shape = ShapeRotatedSquare;
+
+  return res;
+}
+
+// A limit of zero leaves the search unbounded.
+static route
+route_problem(const problem_class& c, r64 limit)
+{
+  route res = { true, limit, "search" };
+
+  if (c.shape == ShapeDegenerate) {
+    res.search = false;
+    res.reason = "no area";
+  }
+  else if (c.shape == ShapeMultiPolygon) {
+    res.reason = "decomposed";
+  }
+  else if (c.magnitude > MaxMagnitude) {
+    res.search = false;
+    res.reason = "coordinates out of range";
+  }
+  else if (c.creases > 0) {
+    res.budget = limit > 0 ? min(limit, ComplexSkeletonSeconds) : ComplexSkeletonSeconds;
+    res.reason = "complex skeleton";
+  }
+
+  return res;
+}
+
+}
@@ -1,14 +1,103 @@
 
+// Search options shared by every problem of a run, with the fold table
+// they point to.
+static s32
+load_options(settings& Settings, fold_table& forward, search_options& options)
+{
+  options = {};
+  if (!Settings.trace_file.empty() && !open_trace(Settings.trace_file)) {
+    cerr << "cannot open trace file " << Settings.trace_file << endl;
+    return 2;
+  }
+  if (Settings.numeric == "float")
+    options.numeric = NumericSingle;
+  else if (Settings.numeric == "double")
+    options.numeric = NumericDouble;
+  else if (Settings.numeric == "fixed")
+    options.numeric = NumericFixed;
+  if (Settings.forward_depth > 0) {
+    forward = fold_forward(Settings.forward_depth, thread::hardware_concurrency());
+    options.forward = &forward;
+  }
+  if (!Settings.patterns_file.empty()) {
+    if (!map_patterns(Settings.patterns_file, forward)) {
+      cerr << "cannot read pattern database " << Settings.patterns_file << endl;
+      return 2;
+    }
+    options.forward = &forward;
+  }
+  return 0;
+}
+
+static list<solution>
+solve_routed(const problem& p, search_options options, r64 time_limit, search_stats& stats)
+{
+  route way;
+  problem_class kind;
+  {
+    trace_span span("classify", "solve");
+    kind = classify(p);
+    way = route_problem(kind, time_limit);
+    stats.shape = shape_name(kind.shape);
+    stats.route = way.reason;
+  }
+
+  if (!way.search)
+    return {};
+  if (kind.shape == ShapeMultiPolygon)
+    return solve_decomposed(p, options, time_limit, stats);
+
+  options.budget = way.budget;
+  auto res = solve_problem(p, options);
+  if (res.size() > 0)
+    stats.resemblance = 1;
+  return res;
+}
 
 static s32
-run_controller(list<string>& files)
+run_controller(settings& Settings)
 {
-  for (string fn : files)
+  ofstream statsFile;
+  if (!Settings.stats_file.empty() && Settings.stats_file != "-")
+    statsFile.open(Settings.stats_file, ofstream::app);
+  ostream& statsOut = statsFile.is_open() ? statsFile : clog;
+
+  search_options options;
+  fold_table forward = {};
+  if (auto err = load_options(Settings, forward, options))
+    return err;
+  options.checkpoint = Settings.checkpoint_file;
+
+  for (string fn : Settings.files)
   {
-    problem p = read_problem(0, fn);
-    list<solution> solved = solve_problem(p);
-    for (solution& r : solved)
-      cout << r;
+    trace_span span("problem", "solve", "\"file\":" + json_string(fn));
+    search_stats stats = {};
+    if (!Settings.stats_file.empty())
+      ActiveStats = &stats;
+
+    problem p;
+    {
+      trace_span span("read", "solve");
+      p = read_problem(problem_id_of(fn), fn);
+    }
+    list<solution> solved = solve_routed(p, options, Settings.time_limit, stats);
+
+    ActiveStats = nullptr;
+    if (!Settings.stats_file.empty())
+      write_stats(statsOut, stats, fn, solved.size() > 0);
+
+    {
+      trace_span span("write", "solve");
+      text_buffer out;
+      for (solution& r : solved) {
+        r.problem_id = p.problem_id;
+        if (Settings.output == "binary")
+          format_result(out.data, r);
+        else
+          format_solution(out, r);
+      }
+      cout.write(out.data.data(), out.data.size());
+    }
     if (solved.size() == 0)
       return 1;
   }
@@ -0,0 +1,112 @@
+#include "unity.cpp"
+
+typedef struct convert_settings_t
+{
+  list<string> files;
+  string output_dir;
+  bool to_binary;
+  bool print_usage_and_exit;
+} convert_settings;
+
+
+static convert_settings
+parse_convert_settings(int argc, char* argv[])
+{
+  int c;
+  int errflg = 0;
+  convert_settings Settings = {};
+
+  while ((c = getopt(argc, argv, "o:bh")) != -1)
+  {
+    switch (c)
+    {
+      case 'o':
+        if (optarg)
+          Settings.output_dir = optarg;
+        break;
+
+      case 'b':
+        Settings.to_binary = true;
+        break;
+
+      case '?':
+      case 'h':
+        errflg++;
+        break;
+    }
+  }
+
+  for (int i = optind; i < argc; i++)
+    Settings.files.push_back(argv[i]);
+
+  if (errflg > 0 || Settings.files.size() == 0 || (Settings.to_binary && !Settings.output_dir.empty()))
+  {
+    Settings.print_usage_and_exit = true;
+  }
+
+  return Settings;
+}
+
+
+// Binary records back to the solver's text, one file per problem under -o,
+// or all of them to stdout; -b goes the other way, from text solution files
+// named after their problem. Coordinates stay decimal and in the solver's
+// frame, api.py postproc turns them into contest fractions.
+int main(int argc, char* argv[])
+{
+  convert_settings Settings = parse_convert_settings(argc, argv);
+
+  if (Settings.print_usage_and_exit)
+  {
+    cerr << "usage: convert [OPTIONS] FILE...\n"
+      "	-o	DIRECTORY	Write NNNNNN-solved.txt per record instead of stdout\n"
+      "	-b		Text solutions to binary records on stdout\n"
+      "\nOutput is decimal text as the solver writes it; run api.py postproc\n"
+      "for the contest fraction format.\n"
+    << endl;
+    return 2;
+  }
+
+  u64 records = 0;
+  for (string fn : Settings.files)
+  {
+    if (Settings.to_binary) {
+      solution sol = read_solution(problem_id_of(fn), fn);
+      string out;
+      format_result(out, sol);
+      cout.write(out.data(), out.size());
+      records++;
+      continue;
+    }
+
+    ifstream fin(fn, ifstream::binary);
+    solution sol;
+    while (read_result(fin, sol)) {
+      text_buffer out;
+      format_solution(out, sol);
+      records++;
+
+      if (Settings.output_dir.empty()) {
+        cout.write(out.data.data(), out.data.size());
+        continue;
+      }
+
+      char name[32];
+      snprintf(name, sizeof(name), "/%06u-solved.txt", sol.problem_id);
+      ofstream fout(Settings.output_dir + name, ofstream::binary | ofstream::trunc);
+      fout.write(out.data.data(), out.data.size());
+      if (!fout.good()) {
+        cerr << "cannot write " << Settings.output_dir + name << endl;
+        return 1;
+      }
+    }
+
+    // a clean end reads nothing of the next header
+    if (!fin.eof() || fin.gcount() > 0) {
+      cerr << fn << ": damaged record after " << records << endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
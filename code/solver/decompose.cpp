@@ -0,0 +1,269 @@
+
+namespace paiv {
+
+// Silhouettes of several polygons: outer ones counterclockwise, holes
+// clockwise, as the contest gives them. The search folds one outline, so
+// when every polygon touches another at a vertex, the whole silhouette is
+// one loop passing that vertex twice and is searched first, exact if
+// solved. Otherwise a folded sheet is connected and can only join parts
+// through such vertices, and the search cannot represent a hole; each
+// outer polygon is searched on its own with its holes covered over, all
+// of them at once, and the fold that scores best against the whole
+// silhouette is kept.
+//
+// Covering part i with its holes scores area_i / (total + holes_i), so the
+// parts are ranked by that before the search; once a part is solved, the
+// parts ranked below it stop. Behind the exact parts come covers: the
+// rectangle of power of two sides around a part no wider than the sheet,
+// which always unfolds back to the square, scoring at least
+// area_i / (total + rect - area_i).
+
+typedef struct silhouette_part {
+  problem prob;
+  r64 area;
+  r64 holes;
+  r64 resemblance;
+  u8 cover;
+} silhouette_part;
+
+static r64
+signed_area(const path& fig)
+{
+  auto& o = fig.front();
+  r64 res = 0;
+  for (size_t i = 0; i < fig.size(); i++) {
+    auto& a = fig[i];
+    auto& b = fig[(i + 1) % fig.size()];
+    res += (a.x - o.x) * (b.y - o.y) - (b.x - o.x) * (a.y - o.y);
+  }
+  return res / 2;
+}
+
+static u8
+contains(const path& fig, const point& p)
+{
+  u8 inside = false;
+  for (size_t i = 0, j = fig.size() - 1; i < fig.size(); j = i++) {
+    auto& a = fig[i];
+    auto& b = fig[j];
+    if ((a.y > p.y) != (b.y > p.y)
+      && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+      inside = !inside;
+  }
+  return inside;
+}
+
+static r64
+cover_side(r64 width)
+{
+  r64 side = 1;
+  while (side / 2 >= width)
+    side /= 2;
+  return side;
+}
+
+static u8
+cover_part(const silhouette_part& part, r64 total, silhouette_part& res)
+{
+  auto box = bbox::empty();
+  for (auto& v : part.prob.outline.front())
+    box.merge({ v.x, v.y, v.x, v.y });
+  if (box.width() > 1 || box.height() > 1)
+    return false;
+  r64 w = cover_side(box.width()), h = cover_side(box.height());
+  path rect = { { box.minx, box.miny }, { box.minx + w, box.miny }, { box.minx + w, box.miny + h }, { box.minx, box.miny + h } };
+
+  res = part;
+  res.prob.outline = { rect };
+  res.prob.skeleton = rect;
+  res.resemblance = part.area / (total + w * h - part.area);
+  res.cover = true;
+  return true;
+}
+
+// Joins fig into the loop at a vertex they share: the loop up to it, fig
+// around from it, then the rest of the loop.
+static u8
+splice(path& loop, const path& fig)
+{
+  for (size_t i = 0; i < loop.size(); i++) {
+    for (size_t j = 0; j < fig.size(); j++) {
+      if (loop[i].x != fig[j].x || loop[i].y != fig[j].y)
+        continue;
+      path res(begin(loop), begin(loop) + i + 1);
+      for (size_t k = 1; k <= fig.size(); k++)
+        res.push_back(fig[(j + k) % fig.size()]);
+      res.insert(end(res), begin(loop) + i + 1, end(loop));
+      loop = res;
+      return true;
+    }
+  }
+  return false;
+}
+
+static u8
+whole_outline(const paths& outline, path& loop)
+{
+  vector<const path*> rest;
+  for (auto& fig : outline) {
+    if (fig.size() < 3)
+      continue;
+    if (loop.empty() && signed_area(fig) > 0)
+      loop = fig;
+    else
+      rest.push_back(&fig);
+  }
+
+  for (u8 joined = true; joined && rest.size() > 0; ) {
+    joined = false;
+    for (size_t i = 0; i < rest.size(); i++) {
+      if (splice(loop, *rest[i])) {
+        rest.erase(begin(rest) + i);
+        joined = true;
+        break;
+      }
+    }
+  }
+  return !loop.empty() && rest.empty();
+}
+
+static vector<silhouette_part>
+decompose(const problem& prob)
+{
+  vector<silhouette_part> res;
+  vector<pair<const path*, r64>> holes;
+  for (auto& fig : prob.outline) {
+    if (fig.size() < 3)
+      continue;
+    auto a = signed_area(fig);
+    if (a > 0) {
+      silhouette_part part = {};
+      part.prob = { prob.problem_id, { fig }, prob.skeleton, prob.denominator, 0 };
+      for (auto& v : fig)
+        part.prob.magnitude = max(part.prob.magnitude, max(fabs(v.x), fabs(v.y)));
+      part.area = a;
+      res.push_back(part);
+    }
+    else if (a < 0) {
+      holes.push_back({ &fig, -a });
+    }
+  }
+
+  // a hole belongs to the smallest outer polygon around its middle; the
+  // vertices themselves may lie on the outer boundary
+  for (auto& hole : holes) {
+    point mid = {};
+    for (auto& v : *hole.first) {
+      mid.x += v.x / hole.first->size();
+      mid.y += v.y / hole.first->size();
+    }
+    silhouette_part* owner = nullptr;
+    for (auto& part : res) {
+      if (contains(part.prob.outline.front(), mid) && (owner == nullptr || part.area < owner->area))
+        owner = &part;
+    }
+    if (owner != nullptr)
+      owner->holes += hole.second;
+  }
+
+  r64 total = 0;
+  for (auto& part : res) {
+    part.area = max<r64>(part.area - part.holes, 0);
+    total += part.area;
+  }
+  if (total <= 0)
+    return {};
+  size_t n = res.size();
+  for (size_t i = 0; i < n; i++) {
+    res[i].resemblance = res[i].area / (total + res[i].holes);
+    silhouette_part cover;
+    if (cover_part(res[i], total, cover))
+      res.push_back(cover);
+  }
+
+  path loop;
+  if (whole_outline(prob.outline, loop)) {
+    silhouette_part whole = {};
+    whole.prob = { prob.problem_id, { loop }, prob.skeleton, prob.denominator, prob.magnitude };
+    whole.area = total;
+    whole.resemblance = 1;
+    res.push_back(whole);
+  }
+
+  stable_sort(begin(res), end(res), [] (const silhouette_part& a, const silhouette_part& b) {
+    return a.resemblance > b.resemblance;
+  });
+  return res;
+}
+
+// Parts share the deadline, each runs under its own route; with more parts
+// than cores they take turns, the best ranked first, so a long search on
+// the whole silhouette cannot starve the parts behind it.
+static list<solution>
+solve_decomposed(const problem& prob, const search_options& options, r64 time_limit, search_stats& stats)
+{
+  auto parts = decompose(prob);
+  stats.parts = parts.size();
+
+  vector<list<solution>> solved(parts.size());
+  vector<search_stats> part_stats(parts.size());
+  vector<atomic<u8>> stop(parts.size());
+  for (auto& x : stop)
+    x = false;
+
+  u8 collect = ActiveStats != nullptr;
+  u32 threads = max<u32>(min<size_t>(parts.size(), thread::hardware_concurrency()), 1);
+  auto started = chrono::steady_clock::now();
+
+  auto work = [&] (u32 t) {
+    auto saved = ActiveStats;
+    for (size_t i = t; i < parts.size(); i += threads) {
+      if (stop[i])
+        continue;
+
+      auto kind = classify(parts[i].prob);
+      auto way = route_problem(kind, time_limit);
+      r64 spent = chrono::duration<r64>(chrono::steady_clock::now() - started).count();
+      if (!way.search || (time_limit > 0 && spent >= time_limit))
+        continue;
+
+      // one checkpoint file cannot hold several searches
+      search_options part = options;
+      part.checkpoint.clear();
+      part.stop = &stop[i];
+      // an even share of what is left with the parts still to come on this
+      // thread, what a quick part leaves over goes to the next
+      size_t left = (parts.size() - i + threads - 1) / threads;
+      part.budget = way.budget > 0 ? max<r64>((way.budget - spent) / left, 0.001) : 0;
+
+      ActiveStats = collect ? &part_stats[i] : nullptr;
+      trace_span span("part", "solve", "\"part\":" + to_string(i) + ",\"cover\":" + (parts[i].cover ? "true" : "false"));
+      solved[i] = solve_problem(parts[i].prob, part);
+      if (solved[i].size() > 0) {
+        for (size_t k = i + 1; k < parts.size(); k++)
+          stop[k] = true;
+      }
+    }
+    ActiveStats = saved;
+  };
+
+  vector<thread> pool;
+  for (u32 t = 1; t < threads; t++)
+    pool.push_back(thread(work, t));
+  work(0);
+  for (auto& th : pool)
+    th.join();
+
+  for (auto& x : part_stats)
+    merge_stats(stats, x);
+
+  for (size_t i = 0; i < parts.size(); i++) {
+    if (solved[i].size() > 0) {
+      stats.resemblance = parts[i].resemblance;
+      return solved[i];
+    }
+  }
+  return {};
+}
+
+}
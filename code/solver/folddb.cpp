@@ -0,0 +1,79 @@
+#include "unity.cpp"
+
+typedef struct folddb_settings_t
+{
+  string output;
+  u32 depth;
+  u32 threads;
+  bool print_usage_and_exit;
+} folddb_settings;
+
+
+static folddb_settings
+parse_folddb_settings(int argc, char* argv[])
+{
+  int c;
+  int errflg = 0;
+  folddb_settings Settings = {};
+  Settings.depth = 3;
+  Settings.threads = thread::hardware_concurrency();
+
+  while ((c = getopt(argc, argv, "o:k:j:h")) != -1)
+  {
+    switch (c)
+    {
+      case 'o':
+        Settings.output = optarg;
+        break;
+
+      case 'k':
+        Settings.depth = atoi(optarg);
+        break;
+
+      case 'j':
+        Settings.threads = atoi(optarg);
+        break;
+
+      case '?':
+      case 'h':
+        errflg++;
+        break;
+    }
+  }
+
+  if (errflg > 0 || Settings.output.empty() || Settings.depth == 0)
+  {
+    Settings.print_usage_and_exit = true;
+  }
+
+  return Settings;
+}
+
+
+int main(int argc, char* argv[])
+{
+  folddb_settings Settings = parse_folddb_settings(argc, argv);
+
+  if (Settings.print_usage_and_exit)
+  {
+    cerr << "usage: folddb [OPTIONS]\n"
+      "	-o	FILENAME	Output pattern database\n"
+      "	-k	DEPTH	Folds of the unit square, default 3\n"
+      "	-j	COUNT	Worker threads, default all cores\n"
+    << endl;
+    return 2;
+  }
+
+  auto start = chrono::steady_clock::now();
+  fold_table table = fold_forward(Settings.depth, Settings.threads);
+  chrono::duration<r64> elapsed = chrono::steady_clock::now() - start;
+
+  if (!write_patterns(table, Settings.output)) {
+    cerr << "cannot write " << Settings.output << endl;
+    return 1;
+  }
+
+  clog << table.entries.size() << " patterns, depth " << Settings.depth
+    << ", " << elapsed.count() << "s" << endl;
+  return 0;
+}
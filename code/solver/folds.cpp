@@ -0,0 +1,292 @@
+
+namespace paiv {
+
+// Forward half of the search: the unit square folded in half along mirror
+// axes of the current shape, which is exactly what a backward unfold undoes.
+// Folded shapes are kept in square coordinates, so every axis of a path
+// lives in the same frame.
+
+// Congruence-invariant fingerprint of a polygon, mirror images included.
+// The signature is the canonical outline itself, the hash only picks the
+// bucket; order maps canonical positions back to vertex indices.
+typedef struct shape_key {
+  u64 hash;
+  vector<s64> signature;
+  vector<size_t> order;
+} shape_key;
+
+typedef struct fold_entry {
+  u64 key;
+  vector<s64> signature;
+  poly shape;
+  vector<edge> axes;
+  vector<size_t> order;
+} fold_entry;
+
+// Shapes whose hashes collide share a bucket and are told apart by their
+// signatures.
+typedef struct fold_table {
+  unordered_multimap<u64, fold_entry> entries;
+  u32 depth;
+
+  // read-only pattern database mapped for the life of the process
+  const u8* mapped;
+  size_t mapped_size;
+
+  size_t size() const;
+  u8 find(const shape_key& key, fold_entry& res) const;
+  const fold_entry* insert(fold_entry&& entry);
+} fold_table;
+
+static s64
+quantize(r64 x)
+{
+  return llround(x * 100000);
+}
+
+// FNV-1a over the signature, low byte first. Pattern files keep these
+// keys, so they must not depend on the standard library's hash.
+static u64
+signature_hash(const vector<s64>& sig)
+{
+  u64 res = 14695981039346656037ull;
+  for (auto x : sig) {
+    for (u32 i = 0; i < 8; i++) {
+      res ^= ((u64) x >> (8 * i)) & 0xff;
+      res *= 1099511628211ull;
+    }
+  }
+  return res;
+}
+
+template <typename F>
+static shape_key
+canonical(const poly_t<F>& fig)
+{
+  shape_key res = { 0 };
+  auto n = fig.size();
+  if (n < 3) return res;
+
+  vector<size_t> index(n);
+  for (size_t i = 0; i < n; i++)
+    index[i] = i;
+
+  r64 signedArea = 0;
+  for (size_t i = 0; i < n; i++) {
+    auto& a = fig[i];
+    auto& b = fig[(i + 1) % n];
+    signedArea += (r64) a.x * b.y - (r64) b.x * a.y;
+  }
+  if (signedArea < 0)
+    reverse(begin(index), end(index));
+
+  // second variant is the mirror image, reversed to stay counterclockwise
+  vector<size_t> mirrored(rbegin(index), rend(index));
+
+  vector<s64> best;
+  for (u8 variant = 0; variant < 2; variant++) {
+    auto& ix = variant ? mirrored : index;
+    poly_t<F> p;
+    for (auto i : ix)
+      p.push_back(variant ? vertex_t<F>{ -fig[i].x, fig[i].y } : fig[i]);
+
+    turn_signature sig(p);
+    vector<s64> seq;
+    for (size_t i = 0; i < n; i++) {
+      seq.push_back(quantize(sig.len[i]));
+      seq.push_back(quantize(sig.cross[i]));
+      seq.push_back(quantize(sig.dot[i]));
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      vector<s64> rotated(begin(seq) + 3 * k, end(seq));
+      rotated.insert(end(rotated), begin(seq), begin(seq) + 3 * k);
+      if (best.empty() || rotated < best) {
+        best = rotated;
+        res.order.clear();
+        for (size_t i = 0; i < n; i++)
+          res.order.push_back(ix[(k + i) % n]);
+      }
+    }
+  }
+
+  res.hash = signature_hash(best);
+  res.signature = move(best);
+  return res;
+}
+
+// The entry as stored, or null when the same shape is there already.
+const fold_entry*
+fold_table::insert(fold_entry&& entry)
+{
+  auto range = entries.equal_range(entry.key);
+  for (auto it = range.first; it != range.second; ++it)
+    if (it->second.signature == entry.signature)
+      return nullptr;
+  auto key = entry.key;
+  return &entries.emplace(key, move(entry))->second;
+}
+
+
+static poly
+clip_left(const poly& fig, const edge& axis)
+{
+  r64 dx = axis.pb.x - axis.pa.x;
+  r64 dy = axis.pb.y - axis.pa.y;
+  auto side = [&] (const vertex& v) {
+    return dx * (v.y - axis.pa.y) - dy * (v.x - axis.pa.x);
+  };
+
+  poly res;
+  for (size_t i = 0; i < fig.size(); i++) {
+    auto& a = fig[i];
+    auto& b = fig[(i + 1) % fig.size()];
+    auto sa = side(a);
+    auto sb = side(b);
+    if (sa >= -0.00001)
+      res.push_back(a);
+    if ((sa > 0.00001 && sb < -0.00001) || (sa < -0.00001 && sb > 0.00001)) {
+      auto t = sa / (sa - sb);
+      res.push_back({ (fraction) (a.x + t * (b.x - a.x)), (fraction) (a.y + t * (b.y - a.y)) });
+    }
+  }
+
+  poly clean;
+  for (auto& v : res) {
+    if (clean.size() > 0 && distance2(clean.back(), v) < 1e-10) continue;
+    if (clean.size() > 1 && same_line(*(end(clean) - 2), clean.back(), v))
+      clean.pop_back();
+    clean.push_back(v);
+  }
+  while (clean.size() > 2 && distance2(clean.front(), clean.back()) < 1e-10)
+    clean.pop_back();
+  if (clean.size() > 2 && same_line(*(end(clean) - 2), clean.back(), clean.front()))
+    clean.pop_back();
+  if (clean.size() > 2 && same_line(clean.back(), clean.front(), clean[1]))
+    clean.erase(begin(clean));
+  return clean;
+}
+
+static vector<fold_entry>
+fold_once(const fold_entry& current)
+{
+  vector<fold_entry> res;
+  for (auto& axis : mirror_axes(current.shape)) {
+    fold_entry folded = {};
+    folded.shape = clip_left(current.shape, axis);
+    if (folded.shape.size() < 3) continue;
+
+    auto key = canonical(folded.shape);
+    folded.key = key.hash;
+    folded.signature = move(key.signature);
+    folded.order = key.order;
+    folded.axes = current.axes;
+    folded.axes.push_back(axis);
+    res.push_back(move(folded));
+  }
+  return res;
+}
+
+// Breadth-first over fold depth. Each layer is folded on all threads,
+// then merged in frontier order so the table does not depend on timing.
+static fold_table
+fold_forward(u32 depth, u32 threads = 1)
+{
+  fold_table table = {};
+  table.depth = depth;
+  threads = max<u32>(threads, 1);
+
+  fold_entry square = {};
+  square.shape = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+  auto key = canonical(square.shape);
+  square.key = key.hash;
+  square.signature = move(key.signature);
+  square.order = key.order;
+
+  // entries of the multimap stay where they are as it grows
+  vector<const fold_entry*> frontier = { table.insert(move(square)) };
+
+  for (u32 d = 0; d < depth && frontier.size() > 0; d++) {
+    vector<vector<fold_entry>> folded(frontier.size());
+
+    auto work = [&] (u32 t) {
+      for (size_t i = t; i < frontier.size(); i += threads)
+        folded[i] = fold_once(*frontier[i]);
+    };
+
+    vector<thread> pool;
+    for (u32 t = 1; t < threads; t++)
+      pool.push_back(thread(work, t));
+    work(0);
+    for (auto& th : pool)
+      th.join();
+
+    vector<const fold_entry*> next;
+    for (auto& children : folded) {
+      for (auto& child : children) {
+        if (auto added = table.insert(move(child)))
+          next.push_back(added);
+      }
+    }
+    frontier = move(next);
+  }
+
+  return table;
+}
+
+template <typename F>
+static matrix3d
+frame(const poly_t<F>& fig, const vector<size_t>& order)
+{
+  auto& a = fig[order[0]];
+  auto& b = fig[order[1]];
+  auto& c = fig[order[2]];
+  return {{ {a.x, a.y, 1}, {b.x, b.y, 1}, {c.x, c.y, 1} }};
+}
+
+template <typename F, typename T>
+static vertex_t<F>
+apply(const matrix3d& m, const vertex_t<T>& v)
+{
+  vector3d u = m.mul(vector3d{{ v.x, v.y, 1 }});
+  return { (F) u.v.x, (F) u.v.y };
+}
+
+// Unfolds the backward state along the forward path, last fold first,
+// with the axes carried over by the congruence between the two shapes.
+// Each axis is snapped to the outline edge it lands on, so mirrored
+// facets link up with exact coordinates.
+template <typename F>
+static search_state_t<F>
+join(const search_state_t<F>& state, const shape_key& key, const fold_entry& entry)
+{
+  auto& fig = state.origami.outline.front();
+  matrix3d m = frame(fig, key.order).mul(frame(entry.shape, entry.order).inverse());
+
+  search_state_t<F> res = {};
+  res.origami = state.origami;
+
+  for (auto it = entry.axes.rbegin(); it != entry.axes.rend(); ++it) {
+    auto a = apply<F>(m, it->pa);
+    auto b = apply<F>(m, it->pb);
+
+    auto& outline = res.origami.outline.front();
+    u8 found = false;
+    edge_t<F> g = {};
+    for (size_t i = 0; i < outline.size() && !found; i++) {
+      g = { outline[i], outline[(i + 1) % outline.size()] };
+      found = same_line(a, b, g.pa) && same_line(a, b, g.pb);
+    }
+    if (!found)
+      return {};
+
+    res.origami = res.origami.unfold(g);
+    if (res.origami.isempty())
+      return {};
+  }
+
+  res.terminal = res.isterminal();
+  return res;
+}
+
+}
@@ -0,0 +1,659 @@
+#include "unity.cpp"
+
+#include <map>
+#include <random>
+
+typedef struct generate_settings_t
+{
+  string output;
+  u32 count;
+  u32 folds;
+  u32 max_facets;
+  u32 grid;
+  u64 seed;
+  bool whole;
+  bool rotate;
+  bool validate;
+  bool print_usage_and_exit;
+} generate_settings;
+
+
+static generate_settings
+parse_generate_settings(int argc, char* argv[])
+{
+  int c;
+  int errflg = 0;
+  generate_settings Settings = {};
+  Settings.count = 1000;
+  Settings.folds = 3;
+  Settings.max_facets = 64;
+  Settings.grid = 16;
+  Settings.seed = 2016;
+
+  while ((c = getopt(argc, argv, "o:n:k:m:g:s:wrvh")) != -1)
+  {
+    switch (c)
+    {
+      case 'o':
+        Settings.output = optarg;
+        break;
+
+      case 'n':
+        Settings.count = atoi(optarg);
+        break;
+
+      case 'k':
+        Settings.folds = atoi(optarg);
+        break;
+
+      case 'm':
+        Settings.max_facets = atoi(optarg);
+        break;
+
+      case 'g':
+        Settings.grid = atoi(optarg);
+        break;
+
+      case 's':
+        Settings.seed = strtoull(optarg, nullptr, 10);
+        break;
+
+      case 'w':
+        Settings.whole = true;
+        break;
+
+      case 'r':
+        Settings.rotate = true;
+        break;
+
+      case 'v':
+        Settings.validate = true;
+        break;
+
+      case '?':
+      case 'h':
+        errflg++;
+        break;
+    }
+  }
+
+  if (errflg > 0 || Settings.output.empty() || Settings.max_facets == 0 || Settings.grid == 0)
+  {
+    Settings.print_usage_and_exit = true;
+  }
+
+  return Settings;
+}
+
+
+// Exact rationals, so every coordinate is written as the contest's num/den
+// and api.py reads it back. Results that would not fit in 64 bits set
+// RationalOverflow, and the fold that needed them is dropped.
+typedef struct rational {
+  s64 num;
+  s64 den;
+} rational;
+
+typedef struct rpoint {
+  rational x;
+  rational y;
+} rpoint;
+
+typedef vector<rpoint> rpath;
+
+// x' = a x + b y + e, y' = c x + d y + f
+typedef struct rmap {
+  rational a, b, c, d, e, f;
+} rmap;
+
+static u8 RationalOverflow = false;
+
+static __int128
+gcd128(__int128 a, __int128 b)
+{
+  if (a < 0) a = -a;
+  if (b < 0) b = -b;
+  while (b != 0) {
+    auto t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+static rational
+make_rational(__int128 num, __int128 den)
+{
+  if (den < 0) {
+    num = -num;
+    den = -den;
+  }
+  auto g = gcd128(num, den);
+  if (g > 1) {
+    num /= g;
+    den /= g;
+  }
+  if (num > INT64_MAX || num < -INT64_MAX || den > INT64_MAX || den == 0) {
+    RationalOverflow = true;
+    return { 0, 1 };
+  }
+  return { (s64) num, (s64) den };
+}
+
+static rational
+operator+(const rational& a, const rational& b)
+{
+  return make_rational((__int128) a.num * b.den + (__int128) b.num * a.den, (__int128) a.den * b.den);
+}
+
+static rational
+operator-(const rational& a, const rational& b)
+{
+  return make_rational((__int128) a.num * b.den - (__int128) b.num * a.den, (__int128) a.den * b.den);
+}
+
+static rational
+operator*(const rational& a, const rational& b)
+{
+  return make_rational((__int128) a.num * b.num, (__int128) a.den * b.den);
+}
+
+static rational
+operator/(const rational& a, const rational& b)
+{
+  if (b.num == 0) {
+    RationalOverflow = true;
+    return { 0, 1 };
+  }
+  return make_rational((__int128) a.num * b.den, (__int128) a.den * b.num);
+}
+
+static s32
+compare(const rational& a, const rational& b)
+{
+  auto x = (__int128) a.num * b.den;
+  auto y = (__int128) b.num * a.den;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static u8
+operator==(const rational& a, const rational& b)
+{
+  return a.num == b.num && a.den == b.den;
+}
+
+static u8
+operator==(const rpoint& a, const rpoint& b)
+{
+  return a.x == b.x && a.y == b.y;
+}
+
+static r64
+to_r64(const rational& x)
+{
+  return (r64) x.num / x.den;
+}
+
+static point
+to_point(const rpoint& p)
+{
+  return { to_r64(p.x), to_r64(p.y) };
+}
+
+static rpoint
+place(const rmap& m, const rpoint& p)
+{
+  return { m.a * p.x + m.b * p.y + m.e, m.c * p.x + m.d * p.y + m.f };
+}
+
+static rpath
+place(const rmap& m, const rpath& fig)
+{
+  rpath res;
+  for (auto& v : fig)
+    res.push_back(place(m, v));
+  return res;
+}
+
+// m after n
+static rmap
+compose(const rmap& m, const rmap& n)
+{
+  return {
+    m.a * n.a + m.b * n.c, m.a * n.b + m.b * n.d,
+    m.c * n.a + m.d * n.c, m.c * n.b + m.d * n.d,
+    m.a * n.e + m.b * n.f + m.e, m.c * n.e + m.d * n.f + m.f,
+  };
+}
+
+static rmap
+inverse(const rmap& m)
+{
+  auto det = m.a * m.d - m.b * m.c;
+  rmap res = {};
+  res.a = m.d / det;
+  res.b = (rational{ 0, 1 } - m.b) / det;
+  res.c = (rational{ 0, 1 } - m.c) / det;
+  res.d = m.a / det;
+  res.e = rational{ 0, 1 } - (res.a * m.e + res.b * m.f);
+  res.f = rational{ 0, 1 } - (res.c * m.e + res.d * m.f);
+  return res;
+}
+
+static const rmap Identity = { {1, 1}, {0, 1}, {0, 1}, {1, 1}, {0, 1}, {0, 1} };
+
+// Mirror across the line through p and q; rational for rational points.
+static rmap
+mirror_map(const rpoint& p, const rpoint& q)
+{
+  auto dx = q.x - p.x;
+  auto dy = q.y - p.y;
+  auto n = dx * dx + dy * dy;
+  rmap res = {};
+  res.a = (dx * dx - dy * dy) / n;
+  res.b = (dx * dy + dx * dy) / n;
+  res.c = res.b;
+  res.d = rational{ 0, 1 } - res.a;
+  res.e = p.x - (res.a * p.x + res.b * p.y);
+  res.f = p.y - (res.c * p.x + res.d * p.y);
+  return res;
+}
+
+
+typedef struct flat_facet {
+  rpath source;
+  rmap transform;
+} flat_facet;
+
+// The flap folded over always lands inside the part that stays, so the
+// silhouette is convex and simply the kept half after every fold.
+typedef struct folding {
+  vector<flat_facet> facets;
+  rpath silhouette;
+  u32 folds;
+} folding;
+
+static const r64 MinFoldArea = 0.0001;
+static const r64 MinVertexDistance = 0.001;
+static const u32 FoldAttempts = 64;
+
+
+static r64
+path_area(const rpath& fig)
+{
+  r64 res = 0;
+  for (size_t i = 0; i < fig.size(); i++) {
+    auto a = to_point(fig[i]);
+    auto b = to_point(fig[(i + 1) % fig.size()]);
+    res += a.x * b.y - b.x * a.y;
+  }
+  return fabs(res) / 2;
+}
+
+static rational
+path_side(const rpoint& a, const rpoint& b, const rpoint& p)
+{
+  return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// Part of the polygon left of a->b.
+static rpath
+clip_side(const rpath& fig, const rpoint& a, const rpoint& b)
+{
+  static const rational zero = { 0, 1 };
+  rpath res;
+  for (size_t i = 0; i < fig.size(); i++) {
+    auto& p = fig[i];
+    auto& q = fig[(i + 1) % fig.size()];
+    auto sp = compare(path_side(a, b, p), zero);
+    auto sq = compare(path_side(a, b, q), zero);
+    if (sp >= 0)
+      res.push_back(p);
+    if (sp * sq < 0) {
+      auto t = path_side(a, b, p) / (path_side(a, b, p) - path_side(a, b, q));
+      res.push_back({ p.x + t * (q.x - p.x), p.y + t * (q.y - p.y) });
+    }
+  }
+  return res.size() < 3 ? rpath() : res;
+}
+
+static u8
+inside_convex(const rpath& fig, const rpoint& p)
+{
+  for (size_t i = 0; i < fig.size(); i++)
+    if (compare(path_side(fig[i], fig[(i + 1) % fig.size()], p), { 0, 1 }) < 0)
+      return false;
+  return true;
+}
+
+// Creases passing next to a vertex leave slivers that no rounded answer
+// can describe, such folds are skipped.
+static u8
+well_spaced(const vector<flat_facet>& facets)
+{
+  path vs;
+  for (auto& f : facets)
+    for (auto& v : f.source)
+      vs.push_back(to_point(v));
+  for (size_t i = 0; i < vs.size(); i++)
+    for (size_t j = i + 1; j < vs.size(); j++) {
+      auto d = fabs(vs[i].x - vs[j].x) + fabs(vs[i].y - vs[j].y);
+      if (d > 1e-9 && d < MinVertexDistance)
+        return false;
+    }
+  return true;
+}
+
+// A point of the bounding box on the 1/grid lattice.
+static rational
+grid_point(r64 lo, r64 hi, u32 grid, mt19937_64& rng)
+{
+  uniform_int_distribution<s64> k((s64) ceil(lo * grid), (s64) floor(hi * grid));
+  return make_rational(k(rng), grid);
+}
+
+// Lines the silhouette is symmetric about: through two of its vertices or
+// edge midpoints, with every vertex mirrored onto a vertex.
+static vector<pair<rpoint, rpoint>>
+mirror_lines(const rpath& fig)
+{
+  rpath marks = fig;
+  for (size_t i = 0; i < fig.size(); i++) {
+    auto& p = fig[i];
+    auto& q = fig[(i + 1) % fig.size()];
+    marks.push_back({ (p.x + q.x) / rational{ 2, 1 }, (p.y + q.y) / rational{ 2, 1 } });
+  }
+
+  vector<pair<rpoint, rpoint>> res;
+  for (size_t i = 0; i < marks.size(); i++)
+    for (size_t j = i + 1; j < marks.size(); j++) {
+      RationalOverflow = false;
+      auto m = mirror_map(marks[i], marks[j]);
+      auto image = place(m, fig);
+      u8 symmetric = !RationalOverflow && all_of(begin(image), end(image), [&fig] (const rpoint& v) {
+        return find(begin(fig), end(fig), v) != end(fig);
+      });
+      // the same line through other marks
+      for (auto& x : res)
+        if (compare(path_side(x.first, x.second, marks[i]), { 0, 1 }) == 0
+          && compare(path_side(x.first, x.second, marks[j]), { 0, 1 }) == 0)
+          symmetric = false;
+      if (symmetric)
+        res.push_back({ marks[i], marks[j] });
+    }
+  return res;
+}
+
+static u8
+fold_sheet(folding& sheet, mt19937_64& rng, u32 maxFacets, u32 grid, u8 whole)
+{
+  r64 minx = INFINITY, miny = INFINITY, maxx = -INFINITY, maxy = -INFINITY;
+  for (auto& v : sheet.silhouette) {
+    auto p = to_point(v);
+    minx = fmin(minx, p.x);
+    miny = fmin(miny, p.y);
+    maxx = fmax(maxx, p.x);
+    maxy = fmax(maxy, p.y);
+  }
+
+  auto axes = whole ? mirror_lines(sheet.silhouette) : vector<pair<rpoint, rpoint>>();
+  if (whole && axes.empty())
+    return false;
+
+  for (u32 attempt = 0; attempt < FoldAttempts; attempt++) {
+    rpoint a, b;
+    if (whole) {
+      // either half may stay
+      auto& g = axes[uniform_int_distribution<size_t>(0, axes.size() - 1)(rng)];
+      auto flip = uniform_int_distribution<u32>(0, 1)(rng);
+      a = flip ? g.second : g.first;
+      b = flip ? g.first : g.second;
+    }
+    else {
+      a = { grid_point(minx, maxx, grid, rng), grid_point(miny, maxy, grid, rng) };
+      b = { grid_point(minx, maxx, grid, rng), grid_point(miny, maxy, grid, rng) };
+      if (distance2(to_point(a), to_point(b)) < 0.0001)
+        continue;
+    }
+
+    RationalOverflow = false;
+    auto kept = clip_side(sheet.silhouette, a, b);
+    auto flap = clip_side(sheet.silhouette, b, a);
+    if (path_area(kept) < MinFoldArea || path_area(flap) < MinFoldArea)
+      continue;
+
+    auto mirror = mirror_map(a, b);
+    auto landed = place(mirror, flap);
+    if (!all_of(begin(landed), end(landed), [&kept] (const rpoint& p) { return inside_convex(kept, p); }))
+      continue;
+
+    vector<flat_facet> facets;
+    for (auto& f : sheet.facets) {
+      auto fig = place(f.transform, f.source);
+      auto back = inverse(f.transform);
+
+      auto stays = clip_side(fig, a, b);
+      if (path_area(stays) > MinFoldArea * MinFoldArea)
+        facets.push_back({ place(back, stays), f.transform });
+
+      auto folds = clip_side(fig, b, a);
+      if (path_area(folds) > MinFoldArea * MinFoldArea)
+        facets.push_back({ place(back, folds), compose(mirror, f.transform) });
+    }
+    if (RationalOverflow || facets.size() > maxFacets || !well_spaced(facets))
+      continue;
+
+    sheet.facets = move(facets);
+    sheet.silhouette = kept;
+    sheet.folds++;
+    return true;
+  }
+  return false;
+}
+
+// A rotation with rational sine and cosine, from a Pythagorean triple,
+// and a shift on the lattice.
+static rmap
+random_placement(u32 grid, mt19937_64& rng)
+{
+  uniform_int_distribution<s64> side(1, 8), sign(0, 1), shift(-(s64) grid, grid);
+  s64 m = side(rng), n = side(rng);
+  auto c = make_rational(m * m - n * n, m * m + n * n);
+  auto s = make_rational(2 * m * n, m * m + n * n);
+  if (sign(rng))
+    s = rational{ 0, 1 } - s;
+  return { c, rational{ 0, 1 } - s, s, c, make_rational(shift(rng), grid), make_rational(shift(rng), grid) };
+}
+
+static folding
+fold_random(u32 folds, u32 maxFacets, u32 grid, u8 whole, u8 rotate, mt19937_64& rng)
+{
+  folding sheet = {};
+  rpath square = {{{0, 1}, {0, 1}}, {{1, 1}, {0, 1}}, {{1, 1}, {1, 1}}, {{0, 1}, {1, 1}}};
+  sheet.facets.push_back({ square, Identity });
+  sheet.silhouette = square;
+
+  for (u32 i = 0; i < folds; i++)
+    if (!fold_sheet(sheet, rng, maxFacets, grid, whole))
+      break;
+
+  for (u32 attempt = 0; rotate && attempt < FoldAttempts; attempt++) {
+    RationalOverflow = false;
+    auto m = random_placement(grid, rng);
+    auto placed = sheet;
+    for (auto& f : placed.facets)
+      f.transform = compose(m, f.transform);
+    placed.silhouette = place(m, sheet.silhouette);
+    // the written answer must fit as well
+    for (auto& f : placed.facets)
+      place(f.transform, f.source);
+    if (!RationalOverflow) {
+      sheet = move(placed);
+      break;
+    }
+  }
+  return sheet;
+}
+
+
+static void
+put_rational(string& out, const rational& x)
+{
+  out += to_string(x.num);
+  if (x.den != 1)
+    out += "/" + to_string(x.den);
+}
+
+static void
+put_point(string& out, const rpoint& p)
+{
+  put_rational(out, p.x);
+  out += ",";
+  put_rational(out, p.y);
+}
+
+static void
+write_problem(const folding& sheet, string& spec, string& known)
+{
+  char buf[32];
+
+  spec = "1\n";
+  snprintf(buf, sizeof(buf), "%zu\n", sheet.silhouette.size());
+  spec += buf;
+  for (auto& v : sheet.silhouette) {
+    put_point(spec, v);
+    spec += "\n";
+  }
+
+  // source vertices are shared between facets that meet at a crease
+  rpath vertices, destination;
+  vector<vrefs> facets;
+  vector<pair<rpoint, rpoint>> skeleton;
+
+  for (auto& f : sheet.facets) {
+    auto dest = place(f.transform, f.source);
+    vrefs refs;
+    for (size_t i = 0; i < f.source.size(); i++) {
+      auto& v = f.source[i];
+      auto it = find(begin(vertices), end(vertices), v);
+      refs.push_back(it - begin(vertices));
+      if (it == end(vertices)) {
+        vertices.push_back(v);
+        destination.push_back(dest[i]);
+      }
+
+      auto& p = dest[i];
+      auto& q = dest[(i + 1) % dest.size()];
+      auto seen = find_if(begin(skeleton), end(skeleton), [&p, &q] (const pair<rpoint, rpoint>& g) {
+        return (g.first == p && g.second == q) || (g.first == q && g.second == p);
+      });
+      if (seen == end(skeleton))
+        skeleton.push_back({ p, q });
+    }
+    facets.push_back(refs);
+  }
+
+  snprintf(buf, sizeof(buf), "%zu\n", skeleton.size());
+  spec += buf;
+  for (auto& g : skeleton) {
+    put_point(spec, g.first);
+    spec += " ";
+    put_point(spec, g.second);
+    spec += "\n";
+  }
+
+  snprintf(buf, sizeof(buf), "%zu\n", vertices.size());
+  known = buf;
+  for (auto& v : vertices) {
+    put_point(known, v);
+    known += "\n";
+  }
+  snprintf(buf, sizeof(buf), "%zu\n", facets.size());
+  known += buf;
+  for (auto& refs : facets) {
+    known += to_string(refs.size());
+    for (auto i : refs)
+      known += " " + to_string(i);
+    known += "\n";
+  }
+  for (auto& v : destination) {
+    put_point(known, v);
+    known += "\n";
+  }
+}
+
+static solution
+as_solution(const string& known, const string& fn)
+{
+  ofstream(fn, ofstream::binary | ofstream::trunc) << known;
+  string name = fn;
+  return read_solution(0, name);
+}
+
+
+int main(int argc, char* argv[])
+{
+  generate_settings Settings = parse_generate_settings(argc, argv);
+
+  if (Settings.print_usage_and_exit)
+  {
+    cerr << "usage: generate [OPTIONS]\n"
+      "	-o	DIR	Output directory\n"
+      "	-n	COUNT	Problems to generate, default 1000\n"
+      "	-k	FOLDS	Folds per problem, default 3\n"
+      "	-m	COUNT	Facet budget per problem, default 64\n"
+      "	-g	GRID	Fold lines through points on the 1/GRID lattice, default 16\n"
+      "	-s	SEED	Random seed, default 2016\n"
+      "	-w		Fold the whole sheet about its mirror axes, as the solver unfolds\n"
+      "	-r		Place each result at a random angle and offset\n"
+      "	-v		Validate every known solution\n"
+    << endl;
+    return 2;
+  }
+
+  mkdir(Settings.output.c_str(), 0755);
+
+  auto start = chrono::steady_clock::now();
+  u32 invalid = 0;
+
+  for (u32 id = 1; id <= Settings.count; id++) {
+    // seeded per problem, so any one of them can be regenerated alone
+    mt19937_64 rng(Settings.seed * 1000003 + id);
+    auto sheet = fold_random(Settings.folds, Settings.max_facets, Settings.grid, Settings.whole, Settings.rotate, rng);
+
+    string spec, known;
+    write_problem(sheet, spec, known);
+
+    char name[32];
+    snprintf(name, sizeof(name), "/%06u", id);
+    string base = Settings.output + name;
+    ofstream(base + "-spec.txt", ofstream::binary | ofstream::trunc) << spec;
+
+    if (Settings.validate) {
+      auto sol = as_solution(known, base + "-solution.txt");
+      if (check_solution(sol, text_size(known)) != nullptr)
+        invalid++;
+    }
+    else {
+      ofstream(base + "-solution.txt", ofstream::binary | ofstream::trunc) << known;
+    }
+
+    ofstream(base + "-meta.json", ofstream::binary | ofstream::trunc)
+      << "{\"problem_id\":" << id
+      << ",\"problem_size\":" << text_size(spec)
+      << ",\"solution_size\":" << text_size(known)
+      << ",\"folds\":" << sheet.folds
+      << ",\"facets\":" << sheet.facets.size()
+      << ",\"seed\":" << Settings.seed
+      << "}" << endl;
+  }
+
+  chrono::duration<r64> elapsed = chrono::steady_clock::now() - start;
+  clog << Settings.count << " problems, " << elapsed.count() << "s, "
+    << (u64) (Settings.count / fmax(elapsed.count(), 1e-9)) << "/s";
+  if (Settings.validate)
+    clog << ", " << invalid << " invalid";
+  clog << endl;
+
+  return invalid > 0 ? 1 : 0;
+}
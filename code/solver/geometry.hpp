@@ -2,48 +2,191 @@
 
 namespace paiv {
 
+template <typename F>
 static inline r64
-distance2(const vertex& a, const vertex& b)
+distance2(const vertex_t<F>& a, const vertex_t<F>& b)
 {
   return (b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y);
 }
 
 
-static vertex
-mirror(const vertex& v, const edge& over) {
-  auto dx = over.pb.x - over.pa.x;
-  auto dy = over.pb.y - over.pa.y;
+template <typename F>
+static r64
+area(const poly_t<F>& fig)
+{
+  r64 res = 0;
+  for (size_t i = 0; i < fig.size(); i++) {
+    auto& a = fig[i];
+    auto& b = fig[(i + 1) % fig.size()];
+    res += (r64) a.x * b.y - (r64) b.x * a.y;
+  }
+  return fabs(res) / 2;
+}
+
+template <typename F>
+static r64
+perimeter(const poly_t<F>& fig)
+{
+  r64 res = 0;
+  for (size_t i = 0; i < fig.size(); i++)
+    res += sqrt(distance2(fig[i], fig[(i + 1) % fig.size()]));
+  return res;
+}
+
+template <typename F>
+static matrix3d
+reflection(const edge_t<F>& over) {
+  r64 dx = over.pb.x - over.pa.x;
+  r64 dy = over.pb.y - over.pa.y;
+  r64 px = over.pa.x;
+  r64 py = over.pa.y;
 
   auto a = (dx*dx - dy*dy) / (dx*dx + dy*dy);
   auto b = 2 * dx*dy / (dx*dx + dy*dy);
 
-  auto x = a * (v.x - over.pa.x) + b * (v.y - over.pa.y) + over.pa.x;
-  auto y = b * (v.x - over.pa.x) - a * (v.y - over.pa.y) + over.pa.y;
+  return {{ {a, b, 0}, {b, -a, 0}, {px - a * px - b * py, py - b * px + a * py, 1} }};
+}
 
-  return { x, y };
+template <typename F>
+static shape_t<F>
+mirror(const shape_t<F>& fig, const edge_t<F>& over) {
+  shape_t<F> newfig = shape_t<F>(fig, false);
+  newfig.place(reflection(over).mul(fig.transform));
+  return newfig;
 }
 
-static shape
-mirror(const shape& fig, const edge& over) {
-  shape newfig = shape(fig, false);
-  for (auto& g : newfig.edges) {
-    g.pa = mirror(g.pa, over);
-    g.pb = mirror(g.pb, over);
+// Side length and the turn at each vertex pin a polygon down up to isometry.
+typedef struct turn_signature {
+  vector<r64> len;
+  vector<r64> cross;
+  vector<r64> dot;
+
+  template <typename F>
+  explicit turn_signature(const poly_t<F>& fig) {
+    auto n = fig.size();
+    for (size_t i = 0; i < n; i++) {
+      auto& a = fig[(i + n - 1) % n];
+      auto& b = fig[i];
+      auto& c = fig[(i + 1) % n];
+      r64 ux = b.x - a.x, uy = b.y - a.y;
+      r64 vx = c.x - b.x, vy = c.y - b.y;
+      len.push_back(vx * vx + vy * vy);
+      cross.push_back(ux * vy - uy * vx);
+      dot.push_back(ux * vx + uy * vy);
+    }
   }
-  for (auto& v : newfig.body) {
-    v = mirror(v, over);
+
+  size_t size() const { return len.size(); }
+
+  u8 same(size_t i, size_t j, size_t e) const {
+    return near(len[i], len[e], 0.00001)
+      && near(cross[i], cross[j], 0.00001)
+      && near(dot[i], dot[j], 0.00001);
   }
-  return newfig;
+
+  // vertex i goes to i + k
+  u8 rotation(size_t k) const {
+    auto n = size();
+    for (size_t i = 0; i < n; i++) {
+      if (!same(i, (i + k) % n, (i + k) % n))
+        return false;
+    }
+    return true;
+  }
+
+  // vertex i goes to r - i, edge i to r - i - 1
+  u8 mirror(size_t r) const {
+    auto n = size();
+    for (size_t i = 0; i < n; i++) {
+      if (!same(i, (2 * n + r - i) % n, (2 * n + r - i - 1) % n))
+        return false;
+    }
+    return true;
+  }
+} turn_signature;
+
+
+// Maps every edge of the polygon to the smallest edge index it reaches
+// under the polygon's rotation and mirror symmetries.
+template <typename F>
+static vector<u32>
+edge_orbits(const poly_t<F>& fig)
+{
+  auto n = fig.size();
+  vector<u32> res(n);
+  for (size_t i = 0; i < n; i++)
+    res[i] = i;
+  if (n < 3) return res;
+
+  turn_signature sig(fig);
+
+  for (size_t k = 1; k < n; k++) {
+    if (sig.rotation(k)) {
+      for (size_t i = 0; i < n; i++)
+        res[i] = min<u32>(res[i], (i + k) % n);
+    }
+  }
+
+  for (size_t r = 0; r < n; r++) {
+    if (sig.mirror(r)) {
+      for (size_t i = 0; i < n; i++)
+        res[i] = min<u32>(res[i], (2 * n + r - i - 1) % n);
+    }
+  }
+
+  return res;
+}
+
+// Lines the polygon is mirror symmetric about. Midpoints of a vertex and
+// its mirror image lie on the line; the two farthest apart span it.
+template <typename F>
+static vector<edge_t<F>>
+mirror_axes(const poly_t<F>& fig)
+{
+  vector<edge_t<F>> res;
+  auto n = fig.size();
+  if (n < 3) return res;
+
+  turn_signature sig(fig);
+
+  for (size_t r = 0; r < n; r++) {
+    if (!sig.mirror(r)) continue;
+
+    poly_t<F> mids;
+    for (size_t i = 0; i < n; i++) {
+      auto& a = fig[i];
+      auto& b = fig[(2 * n + r - i) % n];
+      mids.push_back({ (a.x + b.x) / 2, (a.y + b.y) / 2 });
+    }
+
+    edge_t<F> axis = { mids[0], mids[0] };
+    r64 best = 0;
+    for (auto& a : mids) {
+      for (auto& b : mids) {
+        if (distance2(a, b) > best) {
+          best = distance2(a, b);
+          axis = { a, b };
+        }
+      }
+    }
+
+    if (best > 0)
+      res.push_back(axis);
+  }
+
+  return res;
 }
 
+template <typename F>
 u8
-same_line(const vertex& a, const vertex& b, const vertex& c)
+same_line(const vertex_t<F>& a, const vertex_t<F>& b, const vertex_t<F>& c)
 {
   return near((b.y - a.y) * (c.x - b.x), (c.y - b.y) * (b.x - a.x), 0.00001);
 }
 
+template <typename F>
 u8
-is_clockwise(const vertex& a, const vertex& b, const vertex& c) {
+is_clockwise(const vertex_t<F>& a, const vertex_t<F>& b, const vertex_t<F>& c) {
   auto t = (b.x - a.x)*(b.y + a.y) + (c.x - b.x)*(c.y + b.y) + (a.x - c.x)*(a.y + c.y);
   return t >= 0;
 }
@@ -0,0 +1,226 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PAIV_X86 1
+#endif
+
+namespace paiv {
+
+// Structure-of-arrays coordinate store, the layout batch kernels work on.
+typedef struct coords {
+  vector<r64> x;
+  vector<r64> y;
+
+  size_t size() const { return x.size(); }
+  void resize(size_t n) { x.resize(n); y.resize(n); }
+  void push_back(r64 px, r64 py) { x.push_back(px); y.push_back(py); }
+} coords;
+
+typedef struct bbox {
+  r64 minx;
+  r64 miny;
+  r64 maxx;
+  r64 maxy;
+
+  r64 width() const { return maxx - minx; }
+  r64 height() const { return maxy - miny; }
+
+  void merge(const bbox& other) {
+    minx = fmin(minx, other.minx);
+    miny = fmin(miny, other.miny);
+    maxx = fmax(maxx, other.maxx);
+    maxy = fmax(maxy, other.maxy);
+  }
+
+  static bbox empty() {
+    return { INFINITY, INFINITY, -INFINITY, -INFINITY };
+  }
+} bbox;
+
+
+namespace kernels {
+
+typedef void (*transform_fn)(const matrix3d& m, const r64* xs, const r64* ys, size_t n, r64* ox, r64* oy);
+typedef bbox (*bounds_fn)(const r64* xs, const r64* ys, size_t n);
+
+
+// Scalar versions evaluate in the same order as matrix3d::mul, so every
+// kernel produces bit-identical results.
+
+static void
+transform_scalar(const matrix3d& m, const r64* xs, const r64* ys, size_t n, r64* ox, r64* oy)
+{
+  auto& c = m.m;
+  for (size_t i = 0; i < n; i++) {
+    auto x = xs[i];
+    auto y = ys[i];
+    ox[i] = c.x.x * x + c.y.x * y + c.z.x;
+    oy[i] = c.x.y * x + c.y.y * y + c.z.y;
+  }
+}
+
+static bbox
+bounds_scalar(const r64* xs, const r64* ys, size_t n)
+{
+  bbox res = bbox::empty();
+  for (size_t i = 0; i < n; i++) {
+    res.minx = fmin(res.minx, xs[i]);
+    res.miny = fmin(res.miny, ys[i]);
+    res.maxx = fmax(res.maxx, xs[i]);
+    res.maxy = fmax(res.maxy, ys[i]);
+  }
+  return res;
+}
+
+
+#ifdef PAIV_X86
+
+__attribute__((target("sse2"))) static void
+transform_sse2(const matrix3d& m, const r64* xs, const r64* ys, size_t n, r64* ox, r64* oy)
+{
+  auto& c = m.m;
+  auto xx = _mm_set1_pd(c.x.x);
+  auto yx = _mm_set1_pd(c.y.x);
+  auto zx = _mm_set1_pd(c.z.x);
+  auto xy = _mm_set1_pd(c.x.y);
+  auto yy = _mm_set1_pd(c.y.y);
+  auto zy = _mm_set1_pd(c.z.y);
+
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    auto x = _mm_loadu_pd(xs + i);
+    auto y = _mm_loadu_pd(ys + i);
+    _mm_storeu_pd(ox + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(xx, x), _mm_mul_pd(yx, y)), zx));
+    _mm_storeu_pd(oy + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(xy, x), _mm_mul_pd(yy, y)), zy));
+  }
+  transform_scalar(m, xs + i, ys + i, n - i, ox + i, oy + i);
+}
+
+__attribute__((target("sse2"))) static bbox
+bounds_sse2(const r64* xs, const r64* ys, size_t n)
+{
+  if (n < 2)
+    return bounds_scalar(xs, ys, n);
+
+  auto minx = _mm_loadu_pd(xs);
+  auto miny = _mm_loadu_pd(ys);
+  auto maxx = minx;
+  auto maxy = miny;
+
+  size_t i = 2;
+  for (; i + 2 <= n; i += 2) {
+    auto x = _mm_loadu_pd(xs + i);
+    auto y = _mm_loadu_pd(ys + i);
+    minx = _mm_min_pd(minx, x);
+    miny = _mm_min_pd(miny, y);
+    maxx = _mm_max_pd(maxx, x);
+    maxy = _mm_max_pd(maxy, y);
+  }
+
+  r64 lo[2], hi[2], lo2[2], hi2[2];
+  _mm_storeu_pd(lo, minx);
+  _mm_storeu_pd(lo2, miny);
+  _mm_storeu_pd(hi, maxx);
+  _mm_storeu_pd(hi2, maxy);
+
+  bbox res = { fmin(lo[0], lo[1]), fmin(lo2[0], lo2[1]), fmax(hi[0], hi[1]), fmax(hi2[0], hi2[1]) };
+  res.merge(bounds_scalar(xs + i, ys + i, n - i));
+  return res;
+}
+
+__attribute__((target("avx2"))) static void
+transform_avx2(const matrix3d& m, const r64* xs, const r64* ys, size_t n, r64* ox, r64* oy)
+{
+  auto& c = m.m;
+  auto xx = _mm256_set1_pd(c.x.x);
+  auto yx = _mm256_set1_pd(c.y.x);
+  auto zx = _mm256_set1_pd(c.z.x);
+  auto xy = _mm256_set1_pd(c.x.y);
+  auto yy = _mm256_set1_pd(c.y.y);
+  auto zy = _mm256_set1_pd(c.z.y);
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto x = _mm256_loadu_pd(xs + i);
+    auto y = _mm256_loadu_pd(ys + i);
+    _mm256_storeu_pd(ox + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(xx, x), _mm256_mul_pd(yx, y)), zx));
+    _mm256_storeu_pd(oy + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(xy, x), _mm256_mul_pd(yy, y)), zy));
+  }
+  transform_scalar(m, xs + i, ys + i, n - i, ox + i, oy + i);
+}
+
+__attribute__((target("avx2"))) static bbox
+bounds_avx2(const r64* xs, const r64* ys, size_t n)
+{
+  if (n < 4)
+    return bounds_scalar(xs, ys, n);
+
+  auto minx = _mm256_loadu_pd(xs);
+  auto miny = _mm256_loadu_pd(ys);
+  auto maxx = minx;
+  auto maxy = miny;
+
+  size_t i = 4;
+  for (; i + 4 <= n; i += 4) {
+    auto x = _mm256_loadu_pd(xs + i);
+    auto y = _mm256_loadu_pd(ys + i);
+    minx = _mm256_min_pd(minx, x);
+    miny = _mm256_min_pd(miny, y);
+    maxx = _mm256_max_pd(maxx, x);
+    maxy = _mm256_max_pd(maxy, y);
+  }
+
+  r64 lo[4], hi[4], lo2[4], hi2[4];
+  _mm256_storeu_pd(lo, minx);
+  _mm256_storeu_pd(lo2, miny);
+  _mm256_storeu_pd(hi, maxx);
+  _mm256_storeu_pd(hi2, maxy);
+
+  bbox res = bounds_scalar(xs + i, ys + i, n - i);
+  res.merge(bounds_scalar(lo, lo2, 4));
+  res.merge(bounds_scalar(hi, hi2, 4));
+  return res;
+}
+
+#endif
+
+
+typedef struct dispatch {
+  const char* isa;
+  transform_fn transform;
+  bounds_fn bounds;
+} dispatch;
+
+static dispatch
+select_dispatch()
+{
+#ifdef PAIV_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return { "avx2", transform_avx2, bounds_avx2 };
+  if (__builtin_cpu_supports("sse2"))
+    return { "sse2", transform_sse2, bounds_sse2 };
+#endif
+  return { "scalar", transform_scalar, bounds_scalar };
+}
+
+static const dispatch active = select_dispatch();
+
+
+static inline void
+transform(const matrix3d& m, const coords& src, coords& dst)
+{
+  dst.resize(src.size());
+  active.transform(m, src.x.data(), src.y.data(), src.size(), dst.x.data(), dst.y.data());
+}
+
+static inline bbox
+bounds(const coords& src)
+{
+  return active.bounds(src.x.data(), src.y.data(), src.size());
+}
+
+}
+
+}
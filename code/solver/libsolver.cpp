@@ -0,0 +1,193 @@
+#include "unity.cpp"
+
+#define SOLVER_EXPORT __attribute__((visibility("default")))
+#include "libsolver.h"
+
+
+struct solver_context {
+  fold_table forward;
+  search_options options;
+};
+
+struct solver_problem {
+  problem prob;
+};
+
+struct solver_solution {
+  vector<r64> vertices;
+  vector<r64> destination;
+  vector<u32> offsets;
+  vector<u32> indices;
+  string text;
+  r64 resemblance;
+};
+
+// Reads a caller's buffer in place.
+typedef struct span_buffer : streambuf {
+  span_buffer(const char* data, size_t size) {
+    auto p = const_cast<char*>(data);
+    setg(p, p, p + size);
+  }
+} span_buffer;
+
+
+static solver_solution*
+flatten(const solution& s)
+{
+  auto res = new solver_solution();
+  for (auto& v : s.vertices) {
+    res->vertices.push_back(v.x);
+    res->vertices.push_back(v.y);
+  }
+  for (auto& v : s.destination) {
+    res->destination.push_back(v.x);
+    res->destination.push_back(v.y);
+  }
+  res->offsets.push_back(0);
+  for (auto& refs : s.facets) {
+    res->indices.insert(end(res->indices), begin(refs), end(refs));
+    res->offsets.push_back(res->indices.size());
+  }
+  text_buffer out;
+  format_solution(out, s);
+  res->text = move(out.data);
+  return res;
+}
+
+
+// No exception may cross into the caller; failures come back as NULL.
+extern "C" {
+
+SOLVER_EXPORT uint32_t
+solver_abi_version(void)
+{
+  return SOLVER_ABI_VERSION;
+}
+
+SOLVER_EXPORT solver_context*
+solver_open(const char* patterns, uint32_t forward_depth)
+{
+  try {
+    auto res = new solver_context();
+    if (forward_depth > 0) {
+      res->forward = fold_forward(forward_depth, thread::hardware_concurrency());
+      res->options.forward = &res->forward;
+    }
+    if (patterns != nullptr) {
+      if (!map_patterns(patterns, res->forward)) {
+        delete res;
+        return nullptr;
+      }
+      res->options.forward = &res->forward;
+    }
+    return res;
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+SOLVER_EXPORT void
+solver_close(solver_context* context)
+{
+  delete context;
+}
+
+SOLVER_EXPORT solver_problem*
+solver_parse_problem(const char* spec, size_t size)
+{
+  try {
+    span_buffer buf(spec, size);
+    istream fin(&buf);
+    auto res = new solver_problem();
+    res->prob = read_problem(0, fin);
+    if (res->prob.outline.size() == 0) {
+      delete res;
+      return nullptr;
+    }
+    return res;
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+SOLVER_EXPORT void
+solver_free_problem(solver_problem* problem)
+{
+  delete problem;
+}
+
+SOLVER_EXPORT solver_solution*
+solver_solve(solver_context* context, const solver_problem* problem, const solver_options* options)
+{
+  if (context == nullptr || problem == nullptr)
+    return nullptr;
+  try {
+    auto search = context->options;
+    r64 limit = 0;
+    if (options != nullptr) {
+      if (options->numeric == SOLVER_NUMERIC_FLOAT)
+        search.numeric = NumericSingle;
+      else if (options->numeric == SOLVER_NUMERIC_DOUBLE)
+        search.numeric = NumericDouble;
+      else if (options->numeric == SOLVER_NUMERIC_FIXED)
+        search.numeric = NumericFixed;
+      limit = options->time_limit;
+    }
+
+    search_stats stats = {};
+    auto solved = solve_routed(problem->prob, search, limit, stats);
+    if (solved.size() == 0)
+      return nullptr;
+    auto res = flatten(solved.front());
+    res->resemblance = stats.resemblance;
+    return res;
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+SOLVER_EXPORT void
+solver_free_solution(solver_solution* solution)
+{
+  delete solution;
+}
+
+SOLVER_EXPORT size_t
+solver_solution_vertices(const solver_solution* solution, const double** xy)
+{
+  *xy = solution->vertices.data();
+  return solution->vertices.size() / 2;
+}
+
+SOLVER_EXPORT size_t
+solver_solution_destination(const solver_solution* solution, const double** xy)
+{
+  *xy = solution->destination.data();
+  return solution->destination.size() / 2;
+}
+
+SOLVER_EXPORT size_t
+solver_solution_facets(const solver_solution* solution, const uint32_t** offsets, const uint32_t** indices)
+{
+  *offsets = solution->offsets.data();
+  *indices = solution->indices.data();
+  return solution->offsets.size() - 1;
+}
+
+SOLVER_EXPORT size_t
+solver_solution_text(const solver_solution* solution, const char** text)
+{
+  *text = solution->text.c_str();
+  return solution->text.size();
+}
+
+SOLVER_EXPORT double
+solver_solution_resemblance(const solver_solution* solution)
+{
+  return solution->resemblance;
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef LIBSOLVER_H
+#define LIBSOLVER_H
+
+/*
+ * C interface to the solver core, for callers in other languages.
+ *
+ * A context holds what is loaded once (the fold table), problems and
+ * solutions are opaque handles owned by the caller until freed. Arrays
+ * returned by the accessors point into the solution and stay valid until
+ * it is freed. Calls on distinct problems may run on separate threads.
+ *
+ * Functions returning handles return NULL on failure.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOLVER_ABI_VERSION 2
+
+typedef struct solver_context solver_context;
+typedef struct solver_problem solver_problem;
+typedef struct solver_solution solver_solution;
+
+enum {
+  SOLVER_NUMERIC_AUTO = 0,
+  SOLVER_NUMERIC_FLOAT = 1,
+  SOLVER_NUMERIC_DOUBLE = 2,
+  SOLVER_NUMERIC_FIXED = 3,
+};
+
+typedef struct solver_options {
+  uint32_t numeric;
+  double time_limit;    /* seconds, 0 for none */
+} solver_options;
+
+uint32_t solver_abi_version(void);
+
+/* patterns may be NULL, forward_depth 0 */
+solver_context* solver_open(const char* patterns, uint32_t forward_depth);
+void solver_close(solver_context* context);
+
+/* spec is read in place, in the text format solve -f takes */
+solver_problem* solver_parse_problem(const char* spec, size_t size);
+void solver_free_problem(solver_problem* problem);
+
+/* NULL when no solution was found */
+solver_solution* solver_solve(solver_context* context, const solver_problem* problem,
+  const solver_options* options);
+void solver_free_solution(solver_solution* solution);
+
+/* x, y pairs; returns the vertex count */
+size_t solver_solution_vertices(const solver_solution* solution, const double** xy);
+size_t solver_solution_destination(const solver_solution* solution, const double** xy);
+
+/* facet k lists indices[offsets[k]] .. indices[offsets[k + 1] - 1];
+   returns the facet count */
+size_t solver_solution_facets(const solver_solution* solution,
+  const uint32_t** offsets, const uint32_t** indices);
+
+/* the solution as solve writes it */
+size_t solver_solution_text(const solver_solution* solution, const char** text);
+
+/* estimated resemblance to the problem, below 1 for a partial answer to a
+   silhouette of several polygons */
+double solver_solution_resemblance(const solver_solution* solution);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
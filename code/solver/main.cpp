@@ -8,9 +8,21 @@ int main(int argc, char* argv[])
   {
     cerr << "usage: solve [OPTIONS]\n"
       "	-f	FILENAME	Problem file\n"
+      "	-t	SECONDS	Search time limit per problem\n"
+      "	-p	FILENAME	Append search stats as JSON, - for stderr\n"
+      "	-b	DEPTH	Bidirectional search, folding the square DEPTH times\n"
+      "	-d	FILENAME	Fold pattern database built by folddb\n"
+      "	-n	NUMERIC	float, double or fixed, default picks per problem\n"
+      "	-k	FILENAME	Resume the search from a checkpoint and save it there, one -f only\n"
+      "	-e	FILENAME	Append trace events for chrome://tracing\n"
+      "	-o	FORMAT	text, or binary records for convert\n"
+      "	-i		Serve framed requests on stdin\n"
+      "	-l	SOCKET	Serve framed requests on a Unix socket\n"
     << endl;
     return 2;
   }
 
-  return run_controller(Settings.files);
+  if (Settings.serve)
+    return run_server(Settings);
+  return run_controller(Settings);
 }
@@ -3,11 +3,15 @@
 namespace paiv {
 
 typedef struct vector3d {
-  linalg::aliases::float3 v;
+  linalg::aliases::double3 v;
 } vector3d;
 
 typedef struct matrix3d {
-  linalg::aliases::float3x3 m;
+  linalg::aliases::double3x3 m;
+
+  static matrix3d identity() {
+    return {{ {1, 0, 0}, {0, 1, 0}, {0, 0, 1} }};
+  }
 
   matrix3d inverse() const {
     return { linalg::inverse(m) };
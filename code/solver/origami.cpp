@@ -1,10 +1,11 @@
 
 namespace paiv {
 
-static function<poly(const poly&)>
-unique_mapping(const poly& vs) {
-  unordered_set<vertex> x(begin(vs), end(vs));
-  poly unique(begin(x), end(x));
+template <typename F>
+static function<poly_t<F>(const poly_t<F>&)>
+unique_mapping(const poly_t<F>& vs) {
+  unordered_set<vertex_t<F>> x(begin(vs), end(vs));
+  poly_t<F> unique(begin(x), end(x));
   vector<size_t> indexes;
 
   for (auto v : unique) {
@@ -12,8 +13,8 @@ unique_mapping(const poly& vs) {
     indexes.push_back(i);
   }
 
-  return [indexes] (const poly& us) {
-    poly res;
+  return [indexes] (const poly_t<F>& us) {
+    poly_t<F> res;
     for (size_t i = 0; i < indexes.size(); i++) {
       res.push_back(us[indexes[i]]);
     }
@@ -22,16 +23,35 @@ unique_mapping(const poly& vs) {
 }
 
 
-shape::shape(const shape& other)
-  : shape(other, true)
+template <typename F>
+shape_t<F>::shape_t(const poly& fig)
+  : transform(matrix3d::identity()), cached(fig), materialized(true)
+{
+  coords src;
+  for (size_t i = 0; i < fig.size(); i++) {
+    edge g = { fig[i], fig[(i + 1) % fig.size()], this };
+    edges.push_back(g);
+    src.push_back(fig[i].x, fig[i].y);
+  }
+  sheet = src;
+  source = make_shared<const coords>(move(src));
+}
+
+template <typename F>
+shape_t<F>::shape_t(const shape& other)
+  : shape_t(other, true)
 {
 }
 
-shape::shape(const shape& other, u8 preserveLinks)
+template <typename F>
+shape_t<F>::shape_t(const shape& other, u8 preserveLinks)
 {
-  body = other.body;
-  dest = other.dest;
+  source = other.source;
+  transform = other.transform;
+  sheet = other.sheet;
   edges = other.edges;
+  cached = other.cached;
+  materialized = other.materialized;
   for (auto& g : edges) {
     g.owner = this;
     if (!preserveLinks)
@@ -39,42 +59,96 @@ shape::shape(const shape& other, u8 preserveLinks)
   }
 }
 
-shape::shape(shape&& other) noexcept
+template <typename F>
+shape_t<F>::shape_t(shape&& other) noexcept
+  : transform(other.transform), materialized(other.materialized)
 {
-  swap(body, other.body);
-  swap(dest, other.dest);
+  swap(source, other.source);
+  swap(sheet, other.sheet);
   swap(edges, other.edges);
+  swap(cached, other.cached);
+  for (auto& g : edges)
+    g.owner = this;
 }
 
-shape&
-shape::operator = (shape&& other) noexcept
+template <typename F>
+shape_t<F>&
+shape_t<F>::operator = (shape&& other) noexcept
 {
-  body = move(other.body);
-  dest = move(other.dest);
+  source = move(other.source);
+  transform = other.transform;
+  sheet = move(other.sheet);
   edges = move(other.edges);
+  cached = move(other.cached);
+  materialized = other.materialized;
+  for (auto& g : edges)
+    g.owner = this;
   return *this;
 }
 
-shape&
-shape::operator = (const shape& other)
+template <typename F>
+shape_t<F>&
+shape_t<F>::operator = (const shape& other)
 {
   *this = shape(other);
   return *this;
 }
 
-vector<edge>::reference
-shape::find(const edge& g)
+template <typename F>
+const poly_t<F>&
+shape_t<F>::body() const
+{
+  if (!materialized) {
+    cached.clear();
+    for (size_t i = 0; i < sheet.size(); i++)
+      cached.push_back({ (F) sheet.x[i], (F) sheet.y[i] });
+    materialized = true;
+  }
+  return cached;
+}
+
+template <typename F>
+poly_t<F>
+shape_t<F>::dest() const
+{
+  poly res;
+  for (size_t i = 0; i < source->size(); i++)
+    res.push_back({ (F) source->x[i], (F) source->y[i] });
+  return res;
+}
+
+template <typename F>
+void
+shape_t<F>::place(const matrix3d& m)
+{
+  transform = m;
+  kernels::transform(m, *source, sheet);
+
+  auto n = sheet.size();
+  for (size_t i = 0; i < edges.size(); i++) {
+    auto j = (i + 1) % n;
+    edges[i].pa = { (F) sheet.x[i], (F) sheet.y[i] };
+    edges[i].pb = { (F) sheet.x[j], (F) sheet.y[j] };
+  }
+  materialized = false;
+}
+
+template <typename F>
+typename vector<edge_t<F>>::reference
+shape_t<F>::find(const edge& g)
 {
   return *std::find(begin(edges), end(edges), g);
 }
-vector<edge>::const_reference
-shape::find(const edge& g) const
+template <typename F>
+typename vector<edge_t<F>>::const_reference
+shape_t<F>::find(const edge& g) const
 {
   return *std::find(begin(edges), end(edges), g);
 }
 
+template <typename F>
 u8
-shape::isclockwise(const vertex& a, const vertex& b) const
+shape_t<F>::isclockwise(const vertex& a, const vertex& b) const
 {
   for (auto& dg : edges) {
     if (dg.pa != a && dg.pa != b) {
@@ -90,62 +164,102 @@ shape::isclockwise(const vertex& a, const vertex& b) const
 }
 
 
-Graph::Graph(vector<shape>&& shapes) : shapes(shapes)
+template <typename F>
+Graph_t<F>::Graph_t(vector<shape>&& shapes) : shapes(move(shapes))
 {
 }
 
 
-shape*
-relativePointer(vector<shape>& graph, const vector<shape>& other, const shape* os)
+template <typename F>
+shape_t<F>*
+relativePointer(vector<shape_t<F>>& graph, const vector<shape_t<F>>& other, const shape_t<F>* os)
 {
   return os == nullptr ? nullptr : &*(begin(graph) + (os - &*begin(other)));
 }
-const shape*
-relativePointer(const vector<shape>& graph, const vector<shape>& other, const shape* os)
+template <typename F>
+const shape_t<F>*
+relativePointer(const vector<shape_t<F>>& graph, const vector<shape_t<F>>& other, const shape_t<F>* os)
 {
   return os == nullptr ? nullptr : &*(begin(graph) + (os - &*begin(other)));
 }
 
 
-Graph::Graph(const Graph& other)
+template <typename F>
+Graph_t<F>::Graph_t(const Graph& other)
+  : Graph_t(other, other.shapes.size())
+{
+}
+
+// Room for the mirrored half is reserved up front, so no later insert
+// moves the shapes away from the neighbor pointers.
+template <typename F>
+Graph_t<F>::Graph_t(const Graph& other, size_t capacity)
 {
-  vector<shape> res = other.shapes;
+  shapes.reserve(capacity);
+  for (auto& fig : other.shapes)
+    shapes.emplace_back(fig);
 
-  for (auto& fig : res) {
+  for (auto& fig : shapes) {
     for (auto& g : fig.edges) {
 
       if (g.neighbor != nullptr) {
-        g.neighbor = relativePointer(res, other.shapes, g.neighbor);
+        g.neighbor = relativePointer(shapes, other.shapes, g.neighbor);
       }
 
     }
   }
-
-  shapes = move(res);
 }
 
-Graph::Graph(Graph&& other) noexcept
-  : shapes(other.shapes)
+template <typename F>
+Graph_t<F>::Graph_t(Graph&& other) noexcept
+  : shapes(move(other.shapes))
 {
 }
 
-Graph&
-Graph::operator = (Graph&& other) noexcept
+template <typename F>
+Graph_t<F>&
+Graph_t<F>::operator = (Graph&& other) noexcept
 {
   shapes = move(other.shapes);
   return *this;
 }
 
-Graph&
-Graph::operator = (const Graph& other)
+template <typename F>
+Graph_t<F>&
+Graph_t<F>::operator = (const Graph& other)
 {
   *this = Graph(other);
   return *this;
 }
 
 
+template <typename F>
+bbox
+Graph_t<F>::bounds() const
+{
+  bbox res = bbox::empty();
+  for (auto& fig : shapes)
+    res.merge(kernels::bounds(fig.sheet));
+  return res;
+}
+
+template <typename F>
 size_t
-Graph::hashcode() const {
+Graph_t<F>::bytes() const
+{
+  size_t res = sizeof(Graph) + shapes.capacity() * sizeof(shape);
+  for (auto& fig : shapes) {
+    res += fig.edges.capacity() * sizeof(edge);
+    res += (fig.sheet.x.capacity() + fig.sheet.y.capacity()) * sizeof(r64);
+    res += fig.body().capacity() * sizeof(vertex);
+  }
+  return res;
+}
+
+template <typename F>
+size_t
+Graph_t<F>::hashcode() const {
+  stats_timer timer(&search_stats::hash_seconds);
   hash<shape> h;
   size_t seed = 0;
   for (auto& fig : shapes) {
@@ -154,30 +268,33 @@ Graph::hashcode() const {
   return seed;
 }
 
-poly
-Graph::vertices(u8 destination) const
+template <typename F>
+poly_t<F>
+Graph_t<F>::vertices(u8 destination) const
 {
   poly res;
   for (auto& shape : shapes) {
-    for (auto v : (destination ? shape.dest : shape.body))
+    for (auto v : (destination ? shape.dest() : shape.body()))
       res.push_back(v);
   }
   return res;
 }
 
-poly
-Graph::unique_vertices(u8 destination) const
+template <typename F>
+poly_t<F>
+Graph_t<F>::unique_vertices(u8 destination) const
 {
   unordered_set<vertex> res;
   for (auto& shape : shapes) {
-    for (auto v : (destination ? shape.dest : shape.body))
+    for (auto v : (destination ? shape.dest() : shape.body()))
       res.insert(v);
   }
   return poly(begin(res), end(res));
 }
 
-const vector<edge>
-Graph::edges() const
+template <typename F>
+const vector<edge_t<F>>
+Graph_t<F>::edges() const
 {
   vector<edge> res;
   auto fig = outline().front();
@@ -188,9 +305,11 @@ Graph::edges() const
   return res;
 }
 
-polys
-Graph::outline() const
+template <typename F>
+polys_t<F>
+Graph_t<F>::outline() const
 {
+  stats_timer timer(&search_stats::outline_seconds);
   if (isempty()) return {};
 
   poly res; // ~~
@@ -199,7 +318,7 @@ Graph::outline() const
   auto currentEdge = shapes.front().edges.front();
   for (auto& fig : shapes) {
     for (auto& dg : fig.edges) {
-      if (facetsAt(dg.pa).size() == 1) {
+      if (facetCountAt(dg.pa, 2) == 1) {
         currentEdge = dg;
         goto next;
       }
@@ -247,8 +366,9 @@ next:
   return { res };
 }
 
+template <typename F>
 static vrefs
-convert_to_indices(const poly& values, const poly& refer)
+convert_to_indices(const poly_t<F>& values, const poly_t<F>& refer)
 {
   vrefs facet;
   for (auto v : values) {
@@ -260,31 +380,35 @@ convert_to_indices(const poly& values, const poly& refer)
   return facet;
 }
 
+template <typename F>
 vector<vrefs>
-Graph::facets_as_indices(const poly& refer) const
+Graph_t<F>::facets_as_indices(const poly& refer) const
 {
   vector<vrefs> res;
   for (auto& shape : shapes) {
-    auto facet = convert_to_indices(shape.body, refer);
+    auto facet = convert_to_indices(shape.body(), refer);
     if (facet.size() > 0)
       res.push_back(facet);
   }
   return res;
 }
 
-shape*
-Graph::at(const Graph& other, const shape* os)
+template <typename F>
+shape_t<F>*
+Graph_t<F>::at(const Graph& other, const shape* os)
 {
   return relativePointer(shapes, other.shapes, os);
 }
-const shape*
-Graph::at(const Graph& other, const shape* os) const
+template <typename F>
+const shape_t<F>*
+Graph_t<F>::at(const Graph& other, const shape* os) const
 {
   return relativePointer(shapes, other.shapes, os);
 }
 
-const vector<edge>
-Graph::edgesAt(const vertex& p) const
+template <typename F>
+const vector<edge_t<F>>
+Graph_t<F>::edgesAt(const vertex& p) const
 {
   vector<edge> res;
   for (auto& fig : shapes) {
@@ -296,8 +420,9 @@ Graph::edgesAt(const vertex& p) const
   return res;
 }
 
-vector<edge*>
-Graph::edgesAt(const edge& targetEdge)
+template <typename F>
+vector<edge_t<F>*>
+Graph_t<F>::edgesAt(const edge& targetEdge)
 {
   vector<edge*> res;
   for (auto& fig : shapes) {
@@ -309,8 +434,9 @@ Graph::edgesAt(const edge& targetEdge)
   return res;
 }
 
-const vector<shape>
-Graph::facetsOnEdgePoints(const edge& targetEdge) const
+template <typename F>
+const vector<shape_t<F>>
+Graph_t<F>::facetsOnEdgePoints(const edge& targetEdge) const
 {
   unordered_set<shape> res;
 
@@ -326,8 +452,27 @@ Graph::facetsOnEdgePoints(const edge& targetEdge) const
   return vector<shape>(begin(res), end(res));
 }
 
-const vector<shape>
-Graph::facetsAt(const vertex& targetPoint) const
+// Counting stops at limit, enough to tell a corner of one facet apart.
+template <typename F>
+size_t
+Graph_t<F>::facetCountAt(const vertex& targetPoint, size_t limit) const
+{
+  size_t res = 0;
+  for (auto& fig : shapes) {
+    for (auto& dg : fig.edges) {
+      if (dg.pa == targetPoint || dg.pb == targetPoint) {
+        if (++res >= limit)
+          return res;
+        break;
+      }
+    }
+  }
+  return res;
+}
+
+template <typename F>
+const vector<shape_t<F>>
+Graph_t<F>::facetsAt(const vertex& targetPoint) const
 {
   vector<shape> res;
   for (auto& fig : shapes) {
@@ -341,21 +486,20 @@ Graph::facetsAt(const vertex& targetPoint) const
   return res;
 }
 
-Graph
-Graph::copy_flip(const edge& over) const
+template <typename F>
+Graph_t<F>
+Graph_t<F>::copy_flip(const edge& over) const
 {
-  Graph newGraph = *this;
-  vector<shape> mirroredShapes;
+  stats_timer timer(&search_stats::copy_flip_seconds);
+  Graph newGraph(*this, 2 * shapes.size());
 
   // for (auto& fig : facetsOnEdgePoints(over)) {
   for (auto& fig : shapes) {
-    mirroredShapes.push_back(mirror(fig, over));
+    newGraph.shapes.push_back(mirror(fig, over));
   }
 
-  newGraph.shapes.insert(end(newGraph.shapes), begin(mirroredShapes), end(mirroredShapes));
-
-  for (auto& fig : mirroredShapes) {
-    for (auto& dg : fig.edges) {
+  for (size_t i = shapes.size(); i < newGraph.shapes.size(); i++) {
+    for (auto& dg : newGraph.shapes[i].edges) {
       auto neighborEdges = newGraph.edgesAt(dg);
       if (neighborEdges.size() == 2) {
         neighborEdges[0]->neighbor = neighborEdges[1]->owner;
@@ -385,48 +529,115 @@ Graph::copy_flip(const edge& over) const
   return newGraph;
 }
 
-Origami::Origami(Graph&& other) : graph(other)
+template <typename F>
+void
+Graph_t<F>::link()
+{
+  for (auto& fig : shapes) {
+    for (auto& dg : fig.edges) {
+      auto neighborEdges = edgesAt(dg);
+      if (neighborEdges.size() == 2) {
+        neighborEdges[0]->neighbor = neighborEdges[1]->owner;
+        neighborEdges[1]->neighbor = neighborEdges[0]->owner;
+      }
+    }
+  }
+}
+
+template <typename F>
+Origami_t<F>::Origami_t(Graph&& other) : graph(move(other))
 {
   outline = graph.outline();
+  area = 0;
+  for (auto& fig : outline)
+    area += paiv::area(fig);
+  box = graph.bounds();
+  measure();
 }
 
-Origami
-Origami::from(const polys& outline, const poly& skeleton)
+template <typename F>
+Origami_t<F>::Origami_t(Graph&& other, r64 area, const bbox& box)
+  : graph(move(other)), area(area), box(box)
 {
-  vector<shape> facets;
+  outline = graph.outline();
+  measure();
+}
 
-  if (outline.size() == 1 && skeleton.size() == 4) {
-    for (auto fig : outline) {
-      shape x;
-      x.body = fig;
-      x.dest = fig;
+template <typename F>
+void
+Origami_t<F>::measure()
+{
+  corners = 0;
+  perimeter = 0;
+  outline_area = 0;
+  for (auto& fig : outline) {
+    corners += fig.size();
+    perimeter += paiv::perimeter(fig);
+    outline_area += paiv::area(fig);
+  }
+}
 
-      vector<edge> edges;
-      for (size_t i = 0; i < fig.size(); i++) {
-        edge g = { fig[i], fig[(i + 1) % fig.size()] };
-        edges.push_back(g);
-      }
-      x.edges = edges;
+template <typename F>
+size_t
+Origami_t<F>::bytes() const
+{
+  size_t res = graph.bytes();
+  for (auto& fig : outline)
+    res += sizeof(poly) + fig.capacity() * sizeof(vertex);
+  return res;
+}
 
-      facets.push_back(x);
-    }
-  }
+template <typename F>
+Origami_t<F>
+Origami_t<F>::from(const paths& outline, const path& skeleton)
+{
+  vector<shape> facets;
 
-  for (auto& fig : facets) {
-    for (auto& g : fig.edges)
-      g.owner = &fig;
+  if (outline.size() == 1) {
+    for (auto& fig : outline)
+      facets.emplace_back(poly_cast<F>(fig));
   }
 
   Origami res;
-  res.outline = outline;
+  for (auto& fig : outline)
+    res.outline.push_back(poly_cast<F>(fig));
   res.graph = Graph(move(facets));
+  res.box = res.graph.bounds();
+  for (auto& fig : res.outline)
+    res.area += paiv::area(fig);
+  res.measure();
+  return res;
+}
+
+// The unfolded sheet is this one plus its mirror image, so its bounds are
+// the current box merged with the box of the reflected outline.
+template <typename F>
+bbox
+Origami_t<F>::unfolded_bounds(const edge& g) const
+{
+  coords src, dst;
+  for (auto& fig : outline) {
+    for (auto& v : fig)
+      src.push_back(v.x, v.y);
+  }
+  kernels::transform(reflection(g), src, dst);
+
+  bbox res = kernels::bounds(dst);
+  res.merge(box);
   return res;
 }
 
-Origami
-Origami::unfold(const edge& g) const {
+template <typename F>
+Origami_t<F>
+Origami_t<F>::unfold(const edge& g) const {
+  return unfold(g, unfolded_bounds(g));
+}
+
+template <typename F>
+Origami_t<F>
+Origami_t<F>::unfold(const edge& g, const bbox& box) const {
   auto newgraph = graph.copy_flip(g);
-  return Origami(move(newgraph));
+  return Origami(move(newgraph), area * 2, box);
 }
 
 }
@@ -0,0 +1,181 @@
+
+namespace paiv {
+
+// Fold pattern database, a fold_table saved for mmap.
+//
+//   header    magic "FDB2", depth, record count
+//   index     (key, offset) pairs sorted by key
+//   records   vertex count, axis count, the s64 signature of the shape,
+//             three values a vertex, then r32 coordinates: the shape in
+//             canonical vertex order, followed by the fold axes
+//
+// Keys are signature_hash values, see folds.cpp; records under one key
+// are told apart by the signature. Offsets are from the start of the
+// file; everything is host byte order.
+
+typedef struct pattern_header {
+  char magic[4];
+  u32 depth;
+  u64 count;
+} pattern_header;
+
+typedef struct pattern_index {
+  u64 key;
+  u64 offset;
+} pattern_index;
+
+typedef struct pattern_record {
+  u32 vertices;
+  u32 axes;
+} pattern_record;
+
+static const char PatternMagic[4] = { 'F', 'D', 'B', '2' };
+
+
+static u8
+write_patterns(const fold_table& table, const string& fn)
+{
+  vector<const fold_entry*> sorted;
+  for (auto& it : table.entries)
+    sorted.push_back(&it.second);
+  sort(begin(sorted), end(sorted), [] (const fold_entry* a, const fold_entry* b) {
+    return a->key < b->key || (a->key == b->key && a->signature < b->signature);
+  });
+
+  pattern_header header = {};
+  copy(begin(PatternMagic), end(PatternMagic), header.magic);
+  header.depth = table.depth;
+  header.count = sorted.size();
+
+  vector<pattern_index> index;
+  vector<r32> payload;
+  u64 offset = sizeof(header) + sorted.size() * sizeof(pattern_index);
+
+  for (auto* e : sorted) {
+    index.push_back({ e->key, offset });
+
+    pattern_record rec = { (u32) e->shape.size(), (u32) e->axes.size() };
+    r32 words[2];
+    memcpy(words, &rec, sizeof(rec));
+    payload.insert(end(payload), begin(words), end(words));
+
+    for (auto x : e->signature) {
+      memcpy(words, &x, sizeof(x));
+      payload.insert(end(payload), begin(words), end(words));
+    }
+
+    for (auto i : e->order) {
+      payload.push_back(e->shape[i].x);
+      payload.push_back(e->shape[i].y);
+    }
+    for (auto& g : e->axes) {
+      payload.push_back(g.pa.x);
+      payload.push_back(g.pa.y);
+      payload.push_back(g.pb.x);
+      payload.push_back(g.pb.y);
+    }
+
+    offset = sizeof(header) + sorted.size() * sizeof(pattern_index) + payload.size() * sizeof(r32);
+  }
+
+  ofstream fout(fn, ofstream::binary | ofstream::trunc);
+  fout.write((const char*) &header, sizeof(header));
+  fout.write((const char*) index.data(), index.size() * sizeof(pattern_index));
+  fout.write((const char*) payload.data(), payload.size() * sizeof(r32));
+  return fout.good();
+}
+
+static u8
+map_patterns(const string& fn, fold_table& table)
+{
+  int fd = open(fn.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(pattern_header)) {
+    close(fd);
+    return false;
+  }
+
+  void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return false;
+
+  auto* header = (const pattern_header*) p;
+  if (!equal(begin(PatternMagic), end(PatternMagic), header->magic)
+    || sizeof(pattern_header) + header->count * sizeof(pattern_index) > (size_t) st.st_size) {
+    munmap(p, st.st_size);
+    return false;
+  }
+
+  table.mapped = (const u8*) p;
+  table.mapped_size = st.st_size;
+  table.depth = max(table.depth, header->depth);
+  return true;
+}
+
+
+size_t
+fold_table::size() const
+{
+  size_t res = entries.size();
+  if (mapped != nullptr)
+    res += ((const pattern_header*) mapped)->count;
+  return res;
+}
+
+u8
+fold_table::find(const shape_key& key, fold_entry& res) const
+{
+  auto range = entries.equal_range(key.hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.signature == key.signature) {
+      res = it->second;
+      return true;
+    }
+  }
+
+  if (mapped == nullptr)
+    return false;
+
+  auto* header = (const pattern_header*) mapped;
+  auto* first = (const pattern_index*) (mapped + sizeof(pattern_header));
+  auto* last = first + header->count;
+  auto* at = lower_bound(first, last, key.hash, [] (const pattern_index& x, u64 k) {
+    return x.key < k;
+  });
+
+  for (; at != last && at->key == key.hash; ++at) {
+    if (at->offset + sizeof(pattern_record) > mapped_size)
+      return false;
+    auto* rec = (const pattern_record*) (mapped + at->offset);
+    size_t sigsize = 3 * rec->vertices * sizeof(s64);
+    if (at->offset + sizeof(pattern_record) + sigsize + (2 * rec->vertices + 4 * rec->axes) * sizeof(r32) > mapped_size)
+      return false;
+
+    // the signature may sit off an 8 byte boundary
+    auto* sig = (const u8*) (rec + 1);
+    if (key.signature.size() * sizeof(s64) != sigsize || memcmp(sig, key.signature.data(), sigsize) != 0)
+      continue;
+
+    auto* data = (const r32*) (sig + sigsize);
+    res = {};
+    res.key = key.hash;
+    res.signature = key.signature;
+    for (u32 i = 0; i < rec->vertices; i++) {
+      res.shape.push_back({ data[0], data[1] });
+      res.order.push_back(i);
+      data += 2;
+    }
+    for (u32 i = 0; i < rec->axes; i++) {
+      res.axes.push_back({ { data[0], data[1] }, { data[2], data[3] } });
+      data += 4;
+    }
+    return true;
+  }
+  return false;
+}
+
+}
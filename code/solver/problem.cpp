@@ -2,46 +2,130 @@
 namespace paiv {
 
 
-static vertex
-read_vertex(ifstream& fin) {
+// Decimal input has lost its fraction; the denominator of the first close
+// enough convergent stands in for it.
+static u64
+denominator_of(r64 x)
+{
+  r64 r = x;
+  r64 p0 = 0, p1 = 1, q0 = 1, q1 = 0;
+  for (u32 i = 0; i < 32; i++) {
+    auto a = floor(r);
+    auto p = a * p1 + p0;
+    auto q = a * q1 + q0;
+    if (q > 1e12)
+      break;
+    if (fabs(x - p / q) < 1e-9)
+      return (u64) q;
+    p0 = p1; p1 = p;
+    q0 = q1; q1 = q;
+    r = 1 / (r - a);
+  }
+  return UINT64_MAX;
+}
+
+static r64
+read_fraction(istream& fin, u64* denominator = nullptr) {
+  r64 num = 0, den = 1;
+  fin >> num;
+  u8 exact = fin.peek() == '/';
+  if (exact) {
+    fin.get();
+    fin >> den;
+  }
+  if (denominator != nullptr)
+    *denominator = max(*denominator, exact ? (u64) den : denominator_of(num));
+  return num / den;
+}
+
+static point
+read_vertex(istream& fin, u64* denominator = nullptr) {
   char sep;
-  fraction x, y;
-  fin >> x;
+  r64 x, y;
+  x = read_fraction(fin, denominator);
   fin >> sep;
-  fin >> y;
+  y = read_fraction(fin, denominator);
   return {x, y};
 }
 
-static poly
-read_polygon(ifstream& fin) {
+static path
+read_polygon(istream& fin, u64* denominator = nullptr) {
   u32 verticesCount = 0;
   fin >> verticesCount;
-  poly res;
+  path res;
   for (size_t i = 0; i < verticesCount; i++) {
-    auto v = read_vertex(fin);
+    auto v = read_vertex(fin, denominator);
     res.push_back(v);
   }
   return res;
 }
 
 static problem
-read_problem(u32 id, string& fn)
+read_problem(u32 id, istream& fin)
 {
   problem p = { id };
 
   u32 polygonsCount = 0;
 
-  ifstream fin(fn, ifstream::binary);
-
   fin >> polygonsCount;
   for (size_t i = 0; i < polygonsCount; i++) {
-    auto polygon = read_polygon(fin);
+    auto polygon = read_polygon(fin, &p.denominator);
     p.outline.push_back(polygon);
   }
 
-  p.skeleton = read_polygon(fin);
+  p.skeleton = read_polygon(fin, &p.denominator);
+
+  for (auto& fig : p.outline)
+    for (auto& v : fig)
+      p.magnitude = max(p.magnitude, max(fabs(v.x), fabs(v.y)));
 
   return p;
 }
 
+// Problem files are named after their id, 000042-spec.txt and the like.
+static u32
+problem_id_of(const string& fn)
+{
+  auto slash = fn.find_last_of('/');
+  return (u32) strtoul(fn.c_str() + (slash == string::npos ? 0 : slash + 1), nullptr, 10);
+}
+
+static problem
+read_problem(u32 id, string& fn)
+{
+  ifstream fin(fn, ifstream::binary);
+  return read_problem(id, fin);
+}
+
+// Vertices and facets; the destinations come after them.
+static void
+read_solution_facets(istream& fin, solution& s)
+{
+  s.vertices = read_polygon(fin);
+
+  u32 facetsCount = 0;
+  fin >> facetsCount;
+  for (size_t i = 0; i < facetsCount; i++) {
+    u32 n = 0;
+    fin >> n;
+    vrefs facet(n);
+    for (auto& x : facet)
+      fin >> x;
+    s.facets.push_back(facet);
+  }
+}
+
+static solution
+read_solution(u32 id, string& fn)
+{
+  solution s = { id };
+
+  ifstream fin(fn, ifstream::binary);
+  read_solution_facets(fin, s);
+  for (size_t i = 0; i < s.vertices.size(); i++)
+    s.destination.push_back(read_vertex(fin));
+
+  return s;
+}
+
 }
@@ -0,0 +1,182 @@
+
+// Resident solver. Requests and replies are framed by a header line with
+// the body length, so specs and solutions pass through unchanged:
+//
+//   solve ID LENGTH\n   followed by LENGTH bytes of problem spec
+//   solved ID LENGTH\n  followed by LENGTH bytes of solution
+//   failed ID 0\n
+//   error ID 0\n        the request was not understood; the solver hangs up
+//
+// ID is the client's and only echoed back. Replies go out in request order,
+// each as soon as its search ends. With -i the stream is stdin and stdout;
+// with -l the solver listens on a Unix socket, a thread per connection, all
+// sharing the fold table loaded once at startup.
+
+typedef struct frame_stream {
+  int in;
+  int out;
+  string buffer;
+
+  u8 fill() {
+    char chunk[1 << 16];
+    ssize_t n;
+    do {
+      n = read(in, chunk, sizeof(chunk));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+      return false;
+    buffer.append(chunk, n);
+    return true;
+  }
+
+  u8 read_line(string& line) {
+    size_t at;
+    while ((at = buffer.find('\n')) == string::npos)
+      if (!fill())
+        return false;
+    line = buffer.substr(0, at);
+    buffer.erase(0, at + 1);
+    return true;
+  }
+
+  u8 read_body(size_t size, string& body) {
+    while (buffer.size() < size)
+      if (!fill())
+        return false;
+    body = buffer.substr(0, size);
+    buffer.erase(0, size);
+    return true;
+  }
+
+  u8 write_all(const string& text) {
+    for (size_t done = 0; done < text.size(); ) {
+      auto n = write(out, text.data() + done, text.size() - done);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      done += n;
+    }
+    return true;
+  }
+} frame_stream;
+
+typedef struct server_context {
+  const settings* Settings;
+  search_options options;
+  ostream* stats;
+  mutex stats_lock;
+} server_context;
+
+
+static void
+serve_stream(frame_stream& io, server_context& context)
+{
+  string line, body;
+  while (io.read_line(line)) {
+    istringstream header(line);
+    string verb, id;
+    size_t size = 0;
+    header >> verb >> id >> size;
+
+    // a bad header leaves no way to find the next frame
+    if (verb != "solve" || !header || !io.read_body(size, body)) {
+      io.write_all("error " + id + " 0\n");
+      return;
+    }
+
+    trace_span span("request", "serve", "\"id\":" + json_string(id));
+    search_stats stats = {};
+    if (context.stats != nullptr)
+      ActiveStats = &stats;
+
+    problem p;
+    {
+      trace_span span("read", "solve");
+      istringstream spec(body);
+      p = read_problem(0, spec);
+    }
+    list<solution> solved = solve_routed(p, context.options, context.Settings->time_limit, stats);
+
+    ActiveStats = nullptr;
+    if (context.stats != nullptr) {
+      lock_guard<mutex> lock(context.stats_lock);
+      write_stats(*context.stats, stats, id, solved.size() > 0);
+    }
+
+    text_buffer out;
+    for (solution& r : solved)
+      format_solution(out, r);
+    auto& text = out.data;
+    if (!io.write_all((solved.size() > 0 ? "solved " : "failed ") + id + " "
+      + to_string(text.size()) + "\n" + text))
+      return;
+  }
+}
+
+static s32
+listen_socket(const string& path)
+{
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    return -1;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  unlink(path.c_str());
+  if (::bind(fd, (const sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static s32
+run_server(settings& Settings)
+{
+  ofstream statsFile;
+  if (!Settings.stats_file.empty() && Settings.stats_file != "-")
+    statsFile.open(Settings.stats_file, ofstream::app);
+
+  fold_table forward = {};
+  server_context context;
+  context.Settings = &Settings;
+  context.stats = Settings.stats_file.empty() ? nullptr : statsFile.is_open() ? &statsFile : &clog;
+  if (auto err = load_options(Settings, forward, context.options))
+    return err;
+
+  // a client going away must not take the server with it
+  signal(SIGPIPE, SIG_IGN);
+
+  if (Settings.listen.empty()) {
+    frame_stream io = { 0, 1 };
+    serve_stream(io, context);
+    return 0;
+  }
+
+  int fd = listen_socket(Settings.listen);
+  if (fd < 0) {
+    cerr << "cannot listen on " << Settings.listen << endl;
+    return 2;
+  }
+
+  for (;;) {
+    int client = accept(fd, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    thread([client, &context] {
+      frame_stream io = { client, client };
+      serve_stream(io, context);
+      close(client);
+    }).detach();
+  }
+
+  close(fd);
+  return 2;
+}
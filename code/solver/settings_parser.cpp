@@ -2,6 +2,16 @@
 typedef struct settings_t
 {
   list<string> files;
+  string stats_file;
+  u32 forward_depth;
+  string patterns_file;
+  string numeric;
+  r64 time_limit;
+  string checkpoint_file;
+  string trace_file;
+  string output;
+  bool serve;
+  string listen;
   bool print_usage_and_exit;
 } settings;
 
@@ -13,7 +23,7 @@ parse_settings(int argc, char* argv[])
   int errflg = 0;
   settings Settings = {};
 
-  while ((c = getopt(argc, argv, "f:t:m:c:p:h")) != -1)
+  while ((c = getopt(argc, argv, "f:t:m:c:p:b:d:n:k:e:o:il:h")) != -1)
   {
     switch (c)
     {
@@ -22,6 +32,57 @@ parse_settings(int argc, char* argv[])
           Settings.files.push_back(optarg);
         break;
 
+      case 'p':
+        if (optarg)
+          Settings.stats_file = optarg;
+        break;
+
+      case 'b':
+        if (optarg)
+          Settings.forward_depth = atoi(optarg);
+        break;
+
+      case 'd':
+        if (optarg)
+          Settings.patterns_file = optarg;
+        break;
+
+      case 't':
+        if (optarg)
+          Settings.time_limit = atof(optarg);
+        break;
+
+      case 'n':
+        if (optarg)
+          Settings.numeric = optarg;
+        break;
+
+      case 'k':
+        if (optarg)
+          Settings.checkpoint_file = optarg;
+        break;
+
+      case 'e':
+        if (optarg)
+          Settings.trace_file = optarg;
+        break;
+
+      case 'o':
+        if (optarg)
+          Settings.output = optarg;
+        break;
+
+      case 'i':
+        Settings.serve = true;
+        break;
+
+      case 'l':
+        if (optarg) {
+          Settings.serve = true;
+          Settings.listen = optarg;
+        }
+        break;
+
       case '?':
       case 'h':
         errflg++;
@@ -29,7 +90,12 @@ parse_settings(int argc, char* argv[])
     }
   }
 
-  if (errflg > 0 || Settings.files.size() == 0)
+  // a checkpoint holds one search, problems would overwrite each other's
+  if (errflg > 0 || (Settings.files.size() == 0 && !Settings.serve)
+    || (!Settings.checkpoint_file.empty() && (Settings.files.size() != 1 || Settings.serve))
+    || !(Settings.numeric.empty() || Settings.numeric == "float" || Settings.numeric == "double"
+      || Settings.numeric == "fixed")
+    || !(Settings.output.empty() || Settings.output == "text" || Settings.output == "binary"))
   {
     Settings.print_usage_and_exit = true;
   }
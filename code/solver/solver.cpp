@@ -1,38 +1,36 @@
 
 namespace paiv {
 
-static bool
-is_unit_square(const poly& shape)
-{
-  return near(distance2(shape[0], shape[1]), 1, 0.00001)
-    && near(distance2(shape[1], shape[2]), 1, 0.00001)
-    && near(distance2(shape[2], shape[3]), 1, 0.00001)
-    && near(distance2(shape[3], shape[0]), 1, 0.00001)
-  ;
-}
+static const r64 MaxSheetExtent = M_SQRT2 + 0.00001;
+
+static const r64 Tolerance = 0.00001;
 
+// Among quadrilaterals of perimeter 4 only the unit square has area 1,
+// so the cached outline measures decide the goal exactly.
+template <typename F>
 u8
-search_state::isgoal() const
+search_state_t<F>::isgoal() const
 {
-  if (origami.outline.size() == 1) {
-    auto shape = origami.outline.front();
-    return is_unit_square(shape);
-  }
-  return false;
+  return origami.outline.size() == 1
+    && origami.corners == 4
+    && near(origami.perimeter, 4, Tolerance)
+    && near(origami.outline_area, 1, Tolerance)
+    && near(origami.area, 1, Tolerance);
 }
 
+template <typename F>
 u8
-search_state::isterminal() const
+search_state_t<F>::isterminal() const
 {
   return origami.isempty()
     || isgoal();
 }
 
 
-static poly
-transform_to_initial(const poly& shape, const polys& outline)
+template <typename F>
+static path
+transform_to_initial(const poly_t<F>& shape, const polys_t<F>& outline)
 {
-  static const poly InitialSquare = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
   static const matrix3d us = {{ {0, 0, 1}, {1, 0, 1}, {1, 1, 1} }};
 
   auto& v = outline.front();
@@ -40,99 +38,386 @@ transform_to_initial(const poly& shape, const polys& outline)
 
   matrix3d transform = us.mul(ys.inverse());
 
-  poly res;
-  for (auto p : shape) {
-    vector3d v = {{ p.x, p.y, 1 }};
-    vector3d u = transform.mul(v);
-    auto r = 1e6f;
-    res.push_back({ round(u.v.x * r) / r, round(u.v.y * r) / r });
+  coords src, dst;
+  for (auto p : shape)
+    src.push_back(p.x, p.y);
+  kernels::transform(transform, src, dst);
+
+  path res;
+  for (size_t i = 0; i < dst.size(); i++) {
+    auto r = 1e6;
+    res.push_back({ round(dst.x[i] * r) / r, round(dst.y[i] * r) / r });
   }
 
   return res;
 }
 
+template <typename F>
 solution
-search_state::get_solution() const
+search_state_t<F>::get_solution() const
 {
   solution sol = {};
   if (terminal) {
     auto vs = origami.graph.vertices();
     auto mapping = unique_mapping(vs);
-    sol.vertices = mapping(vs);
-    sol.facets = origami.graph.facets_as_indices(sol.vertices);
-    sol.vertices = transform_to_initial(sol.vertices, origami.outline);
-    sol.destination = mapping(origami.graph.vertices(true));
+    auto unique = mapping(vs);
+    sol.facets = origami.graph.facets_as_indices(unique);
+    sol.vertices = transform_to_initial(unique, origami.outline);
+    sol.destination = poly_cast<r64>(mapping(origami.graph.vertices(true)));
   }
   return sol;
 }
 
-vector<search_state>
-search_state::children() const {
-  vector<search_state> res;
-  if (terminal) return res;
+template <typename F>
+static u8
+same_axis(const edge_t<F>& a, const edge_t<F>& b)
+{
+  return same_line(a.pa, a.pb, b.pa) && same_line(a.pa, a.pb, b.pb);
+}
+
+// An axis with paper on both sides folds the mirror image over existing
+// layers; the overlap never goes away, so such a sheet is never a goal.
+template <typename F>
+static u8
+covers_both_sides(const poly_t<F>& fig, const edge_t<F>& g)
+{
+  r64 dx = g.pb.x - g.pa.x;
+  r64 dy = g.pb.y - g.pa.y;
+  u8 left = false, right = false;
+  for (auto& v : fig) {
+    auto side = dx * (v.y - g.pa.y) - dy * (v.x - g.pa.x);
+    left |= side > Tolerance;
+    right |= side < -Tolerance;
+  }
+  return left && right;
+}
+
+// Outline edges worth unfolding over: one per fold line, only lines with
+// all the paper on one side, and on the start state one per symmetry orbit.
+template <typename F>
+vector<edge_t<F>>
+search_state_t<F>::unfold_axes() const {
+  vector<edge> res;
+  if (origami.outline.size() == 0) return res;
+
+  auto& fig = origami.outline.front();
+  for (size_t i = 0; i < fig.size(); i++) {
+    edge g = { fig[i], fig[(i + 1) % fig.size()] };
+
+    if (i < redundant.size() && redundant[i]) {
+      stats_count(&search_stats::pruned_symmetric);
+      continue;
+    }
+
+    if (any_of(begin(res), end(res), [&g] (const edge& x) { return same_axis(x, g); })) {
+      stats_count(&search_stats::pruned_collinear);
+      continue;
+    }
+
+    if (covers_both_sides(fig, g)) {
+      stats_count(&search_stats::pruned_overlap);
+      continue;
+    }
+
+    res.push_back(g);
+  }
+
+  return res;
+}
+
+template <typename F>
+void
+search_state_t<F>::expand(const function<u8(search_state&)>& yield) const {
+  if (terminal) return;
 
-  for (auto g : origami.graph.edges()) {
+  // every unfold doubles the paper, more than a unit square never folds back
+  if (origami.area * 2 > 1 + Tolerance) {
+    stats_count(&search_stats::pruned_area);
+    return;
+  }
 
-    auto newo = origami.unfold(g);
+  for (auto& g : unfold_axes()) {
+
+    // neither does a sheet wider than the unit square diagonal
+    auto box = origami.unfolded_bounds(g);
+    if (box.width() > MaxSheetExtent || box.height() > MaxSheetExtent) {
+      stats_count(&search_stats::pruned_extent);
+      continue;
+    }
+
+    auto newo = origami.unfold(g, box);
     if (newo.isempty()) continue;
 
     search_state next = {};
     next.origami = move(newo);
     next.terminal = next.isterminal();
-    res.push_back(move(next));
+    if (!yield(next))
+      break;
   }
+}
 
+template <typename F>
+vector<search_state_t<F>>
+search_state_t<F>::children() const {
+  vector<search_state> res;
+  expand([&res] (search_state& next) {
+    res.push_back(move(next));
+    return true;
+  });
   return res;
 }
 
 
-typedef queue<search_state> fringe;
-typedef unordered_set<search_state> history;
+// Numeric policy the search runs with; single precision is the fast
+// path, fixed point keeps larger denominators exact, double takes the rest.
+typedef enum numeric_policy {
+  NumericAuto,
+  NumericSingle,
+  NumericDouble,
+  NumericFixed,
+} numeric_policy;
+
+typedef struct search_options {
+  const fold_table* forward;
+  numeric_policy numeric;
+  r64 budget;
+  string checkpoint;
+  const atomic<u8>* stop;
+} search_options;
+
+// How often a search with a checkpoint file saves its state, besides
+// when it runs out of time.
+static const r64 CheckpointSeconds = 10;
+
 
+// States live once, in the history; set nodes never move, so the fringe
+// queues pointers to them.
+template <typename F> using fringe_t = queue<const search_state_t<F>*>;
+template <typename F> using history_t = unordered_set<search_state_t<F>>;
+
+template <typename F>
+static inline void
+stats_hold(const search_state_t<F>& state, s64 sign)
+{
+  if (ActiveStats != nullptr)
+    stats_hold(sign * (s64) state.origami.bytes());
+}
+
+// Goal and duplicate tests run as each child is generated, so the search
+// stops on the first solution without building the rest of the layer.
+//
+// With a forward fold table the search is bidirectional: every generated
+// state whose outline matches a folded shape is joined with that fold path.
+template <typename F>
 static list<solution>
-solve_problem(problem& prob)
+solve_with(const problem& prob, const search_options& options)
 {
+  typedef search_state_t<F> search_state;
+  typedef Origami_t<F> Origami;
+
+  stats_timer timer(&search_stats::total_seconds);
   list<solution> results;
+  auto deadline = chrono::steady_clock::now() + chrono::duration<r64>(options.budget);
 
-  fringe fringe;
-  history visited;
+  fringe_t<F> fringe;
+  history_t<F> visited;
 
-  search_state state = {};
-  state.origami = Origami::from(prob.outline, prob.skeleton);
-  state.terminal = state.isterminal();
+  if (ActiveStats != nullptr && options.forward != nullptr)
+    ActiveStats->forward_states = options.forward->size();
 
-  fringe.push(state);
+  auto goal = [&results] (const search_state& state) {
+    if (state.isgoal()) {
+      auto sol = state.get_solution();
+      if (sol.facets.size() > 0) {
+        // a malformed answer is worse than none, keep searching past it
+        if (check_solution(sol) != nullptr) {
+          stats_count(&search_stats::rejected_solutions);
+          return false;
+        }
+        results.push_back(sol);
+        return true;
+      }
+    }
+    return false;
+  };
 
-  while (fringe.size() > 0) {
-    auto& state = fringe.front();
+  auto accept = [&] (const search_state& state) {
+    if (goal(state))
+      return true;
 
-    // ~~
-    // clog << state << endl;
+    if (options.forward == nullptr || state.origami.outline.size() != 1)
+      return false;
 
-    if (visited.find(state) == end(visited)) {
-      visited.insert(state);
+    auto key = canonical(state.origami.outline.front());
+    fold_entry entry;
+    if (!options.forward->find(key, entry))
+      return false;
 
-      if (state.isgoal()) {
-        auto sol = state.get_solution();
-        if (sol.facets.size() > 0) {
-          results.push_back(sol);
-          break;
-        }
-      }
+    stats_count(&search_stats::meets);
+    return goal(join(state, key, entry));
+  };
 
-      auto children = state.children();
-      fringe.pop();
-      for (auto& child : children) {
-        fringe.push(child);
-      }
+  search_state start = {};
+  start.origami = Origami::from(prob.outline, prob.skeleton);
+  start.terminal = start.isterminal();
+
+  // children over symmetric axes of the silhouette are congruent
+  if (start.origami.outline.size() == 1) {
+    auto orbits = edge_orbits(start.origami.outline.front());
+    for (size_t i = 0; i < orbits.size(); i++)
+      start.redundant.push_back(orbits[i] != i);
+  }
+
+  if (accept(start))
+    return results;
+
+  // a resumed search keeps only hashes of the states it expanded before
+  checkpoint_t<F> saved = {};
+  saved.problem = visited.hash_function()(start);
+  auto began = chrono::steady_clock::now();
+  u64 expanded = 0;
+  auto next_save = began + chrono::duration<r64>(CheckpointSeconds);
+
+  auto save = [&] () {
+    trace_span span("checkpoint", "solve");
+    vector<const search_state*> rest;
+    for (auto q = fringe; q.size() > 0; q.pop())
+      rest.push_back(q.front());
+    unordered_set<u64> seen = saved.seen;
+    for (auto& state : visited)
+      seen.insert(visited.hash_function()(state));
+
+    checkpoint_t<F> head = saved;
+    head.expanded += expanded;
+    head.seconds += chrono::duration<r64>(chrono::steady_clock::now() - began).count();
+    if (!write_checkpoint(options.checkpoint, head, rest, seen))
+      cerr << "cannot write checkpoint " << options.checkpoint << endl;
+  };
+
+  if (!options.checkpoint.empty() && read_checkpoint(options.checkpoint, saved.problem, saved)) {
+    for (auto& state : saved.fringe) {
+      auto added = visited.emplace(move(state));
+      if (!added.second)
+        continue;
+      stats_hold(*added.first, 1);
+      fringe.push(&*added.first);
+    }
+    saved.fringe.clear();
+    if (ActiveStats != nullptr)
+      ActiveStats->resumed_states = fringe.size();
+  }
+  else {
+    auto first = visited.emplace(move(start)).first;
+    stats_hold(*first, 1);
+    fringe.push(&*first);
+  }
+
+  while (fringe.size() > 0 && results.size() == 0) {
+    auto now = chrono::steady_clock::now();
+    if (options.budget > 0 && now > deadline) {
+      stats_count(&search_stats::out_of_time);
+      break;
+    }
+    if (options.stop != nullptr && *options.stop)
+      break;
+    if (!options.checkpoint.empty() && now > next_save) {
+      save();
+      next_save = chrono::steady_clock::now() + chrono::duration<r64>(CheckpointSeconds);
     }
-    else {
-      fringe.pop();
+
+    auto& state = *fringe.front();
+    fringe.pop();
+    expanded++;
+
+    u64 generated = 0;
+    u64 allocations = ActiveStats != nullptr ? ActiveStats->allocations : 0;
+    state.expand([&] (search_state& child) {
+      generated++;
+
+      u8 known = saved.seen.size() > 0 && saved.seen.count(visited.hash_function()(child)) > 0;
+      auto added = known ? make_pair(visited.end(), false) : visited.emplace(move(child));
+      if (!added.second) {
+        if (ActiveStats != nullptr)
+          ActiveStats->duplicate_hits++;
+        return true;
+      }
+
+      auto& kept = *added.first;
+      if (accept(kept))
+        return false;
+
+      stats_hold(kept, 1);
+      fringe.push(&kept);
+      return true;
+    });
+
+    if (ActiveStats != nullptr) {
+      ActiveStats->max_node_allocations = max(ActiveStats->max_node_allocations,
+        ActiveStats->allocations - allocations);
+      ActiveStats->nodes_expanded++;
+      ActiveStats->children_generated += generated;
+      ActiveStats->max_fringe = max<u64>(ActiveStats->max_fringe, fringe.size());
     }
   }
 
+  // a solved problem has nothing left to resume
+  if (!options.checkpoint.empty()) {
+    if (results.size() > 0)
+      unlink(options.checkpoint.c_str());
+    else
+      save();
+  }
+
   return results;
 }
 
 
+// Reflections multiply denominators; a float mantissa keeps the sheet
+// exact while the problem's denominators stay this small, and its
+// coordinates close enough to the origin.
+static const u64 SingleMaxDenominator = 1 << 8;
+static const r64 SingleMaxMagnitude = 16;
+
+// Two input coordinates differ by at least 1/D^2, which the 2^-32 lattice
+// still tells apart; an unknown denominator (decimal input) stays double.
+static const u64 FixedMaxDenominator = 1 << 16;
+static const r64 FixedMaxMagnitude = 1 << 20;
+
+static numeric_policy
+choose_numeric(const problem& prob)
+{
+  if (prob.denominator <= SingleMaxDenominator && prob.magnitude <= SingleMaxMagnitude)
+    return NumericSingle;
+  if (prob.denominator <= FixedMaxDenominator && prob.magnitude <= FixedMaxMagnitude)
+    return NumericFixed;
+  return NumericDouble;
+}
+
+static const char*
+numeric_name(numeric_policy numeric)
+{
+  switch (numeric) {
+    case NumericSingle: return "float";
+    case NumericFixed: return "fixed";
+    default: return "double";
+  }
+}
+
+static list<solution>
+solve_problem(const problem& prob, const search_options& options)
+{
+  auto numeric = options.numeric == NumericAuto ? choose_numeric(prob) : options.numeric;
+  auto name = numeric_name(numeric);
+  if (ActiveStats != nullptr)
+    ActiveStats->numeric = name;
+
+  trace_span span("search", "solve", string("\"numeric\":\"") + name + "\"");
+
+  if (numeric == NumericSingle)
+    return solve_with<r32>(prob, options);
+  if (numeric == NumericFixed)
+    return solve_with<q32>(prob, options);
+  return solve_with<r64>(prob, options);
+}
+
 }
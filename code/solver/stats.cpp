@@ -0,0 +1,195 @@
+
+namespace paiv {
+
+typedef chrono::steady_clock stats_clock;
+
+typedef struct search_stats {
+  const char* shape;
+  const char* route;
+  const char* numeric;
+  u64 nodes_expanded;
+  u64 children_generated;
+  u64 duplicate_hits;
+  u64 max_fringe;
+  u64 pruned_area;
+  u64 pruned_extent;
+  u64 pruned_collinear;
+  u64 pruned_overlap;
+  u64 pruned_symmetric;
+  u64 forward_states;
+  u64 meets;
+  u64 rejected_solutions;
+  u64 out_of_time;
+  u64 resumed_states;
+  u64 parts;
+  r64 resemblance;
+  u64 bytes_held;
+  u64 max_bytes_held;
+  u64 allocations;
+  u64 allocated_bytes;
+  u64 max_node_allocations;
+  r64 copy_flip_seconds;
+  r64 outline_seconds;
+  r64 hash_seconds;
+  r64 total_seconds;
+} search_stats;
+
+// Counters are collected only while a record is active on this thread,
+// so the disabled path costs one pointer test.
+static thread_local search_stats* ActiveStats = nullptr;
+
+
+typedef struct stats_timer {
+  r64 search_stats::* field;
+  stats_clock::time_point start;
+
+  explicit stats_timer(r64 search_stats::* field) : field(field) {
+    if (ActiveStats != nullptr)
+      start = stats_clock::now();
+  }
+
+  ~stats_timer() {
+    if (ActiveStats != nullptr) {
+      chrono::duration<r64> elapsed = stats_clock::now() - start;
+      ActiveStats->*field += elapsed.count();
+    }
+  }
+} stats_timer;
+
+
+static inline void
+stats_hold(s64 bytes)
+{
+  if (ActiveStats != nullptr) {
+    ActiveStats->bytes_held += bytes;
+    ActiveStats->max_bytes_held = max(ActiveStats->max_bytes_held, ActiveStats->bytes_held);
+  }
+}
+
+static inline void
+stats_count(u64 search_stats::* field)
+{
+  if (ActiveStats != nullptr)
+    ActiveStats->*field += 1;
+}
+
+// A JSON string literal, quotes included; file names and request ids may
+// hold anything.
+static string
+json_string(const string& text)
+{
+  string res = "\"";
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      res.push_back('\\');
+      res.push_back(c);
+    }
+    else if (c < 0x20) {
+      char tmp[8];
+      snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+      res.append(tmp);
+    }
+    else {
+      res.push_back(c);
+    }
+  }
+  res.push_back('"');
+  return res;
+}
+
+// Counters of searches that ran side by side, added into one record.
+static void
+merge_stats(search_stats& into, const search_stats& s)
+{
+  if (into.numeric == nullptr)
+    into.numeric = s.numeric;
+  into.nodes_expanded += s.nodes_expanded;
+  into.children_generated += s.children_generated;
+  into.duplicate_hits += s.duplicate_hits;
+  into.max_fringe = max(into.max_fringe, s.max_fringe);
+  into.pruned_area += s.pruned_area;
+  into.pruned_extent += s.pruned_extent;
+  into.pruned_collinear += s.pruned_collinear;
+  into.pruned_overlap += s.pruned_overlap;
+  into.pruned_symmetric += s.pruned_symmetric;
+  into.forward_states = max(into.forward_states, s.forward_states);
+  into.meets += s.meets;
+  into.rejected_solutions += s.rejected_solutions;
+  into.out_of_time += s.out_of_time;
+  into.resumed_states += s.resumed_states;
+  into.bytes_held += s.bytes_held;
+  into.max_bytes_held += s.max_bytes_held;
+  into.allocations += s.allocations;
+  into.allocated_bytes += s.allocated_bytes;
+  into.max_node_allocations = max(into.max_node_allocations, s.max_node_allocations);
+  into.copy_flip_seconds += s.copy_flip_seconds;
+  into.outline_seconds += s.outline_seconds;
+  into.hash_seconds += s.hash_seconds;
+  into.total_seconds += s.total_seconds;
+}
+
+static void
+write_stats(ostream& so, const search_stats& s, const string& file, u8 solved)
+{
+  so << "{\"file\":" << json_string(file)
+    << ",\"solved\":" << (solved ? "true" : "false")
+    << ",\"shape\":\"" << (s.shape ? s.shape : "") << "\""
+    << ",\"route\":\"" << (s.route ? s.route : "") << "\""
+    << ",\"numeric\":\"" << (s.numeric ? s.numeric : "") << "\""
+    << ",\"nodes_expanded\":" << s.nodes_expanded
+    << ",\"children_generated\":" << s.children_generated
+    << ",\"duplicate_hits\":" << s.duplicate_hits
+    << ",\"max_fringe\":" << s.max_fringe
+    << ",\"pruned_area\":" << s.pruned_area
+    << ",\"pruned_extent\":" << s.pruned_extent
+    << ",\"pruned_collinear\":" << s.pruned_collinear
+    << ",\"pruned_overlap\":" << s.pruned_overlap
+    << ",\"pruned_symmetric\":" << s.pruned_symmetric
+    << ",\"forward_states\":" << s.forward_states
+    << ",\"meets\":" << s.meets
+    << ",\"rejected_solutions\":" << s.rejected_solutions
+    << ",\"out_of_time\":" << s.out_of_time
+    << ",\"resumed_states\":" << s.resumed_states
+    << ",\"parts\":" << s.parts
+    << ",\"resemblance\":" << s.resemblance
+    << ",\"bytes_held\":" << s.bytes_held
+    << ",\"max_bytes_held\":" << s.max_bytes_held
+    << ",\"allocations\":" << s.allocations
+    << ",\"allocated_bytes\":" << s.allocated_bytes
+    << ",\"allocations_per_node\":" << (s.nodes_expanded ? (r64) s.allocations / s.nodes_expanded : 0)
+    << ",\"bytes_per_node\":" << (s.nodes_expanded ? (r64) s.allocated_bytes / s.nodes_expanded : 0)
+    << ",\"max_node_allocations\":" << s.max_node_allocations
+    << ",\"copy_flip_seconds\":" << s.copy_flip_seconds
+    << ",\"outline_seconds\":" << s.outline_seconds
+    << ",\"hash_seconds\":" << s.hash_seconds
+    << ",\"total_seconds\":" << s.total_seconds
+    << "}" << endl;
+}
+
+}
+
+
+// Every heap allocation made while a record is active is counted, which
+// keeps copies out of the search loop visible in the stats. A debug
+// counter: it replaces the global operator new, so only builds configured
+// with COUNT_ALLOCATIONS have it, and never the shared library.
+#ifdef COUNT_ALLOCATIONS
+static inline void*
+stats_alloc(size_t size)
+{
+  if (paiv::ActiveStats != nullptr) {
+    paiv::ActiveStats->allocations++;
+    paiv::ActiveStats->allocated_bytes += size;
+  }
+  if (void* p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+
+void* operator new (size_t size) { return stats_alloc(size); }
+void* operator new[] (size_t size) { return stats_alloc(size); }
+void operator delete (void* p) noexcept { free(p); }
+void operator delete[] (void* p) noexcept { free(p); }
+void operator delete (void* p, size_t) noexcept { free(p); }
+void operator delete[] (void* p, size_t) noexcept { free(p); }
+#endif
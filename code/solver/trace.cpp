@@ -0,0 +1,67 @@
+
+namespace paiv {
+
+// Span events in the Chrome trace event format, one complete ("X") event
+// per line, appended to a file the batch scripts write to as well:
+//
+//   [
+//   {"name":"search","cat":"solve","ph":"X","ts":...,"dur":...,"pid":...,"tid":...,"args":{...}},
+//
+// Viewers accept the array without its closing bracket. Timestamps are
+// microseconds of the system clock, so events of every process line up;
+// each event is one write to an O_APPEND descriptor, so writers do not
+// interleave.
+
+static int TraceFd = -1;
+
+static u8
+open_trace(const string& fn)
+{
+  TraceFd = open(fn.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (TraceFd < 0)
+    return false;
+
+  // whoever finds the file empty opens the array
+  struct stat st;
+  flock(TraceFd, LOCK_EX);
+  if (fstat(TraceFd, &st) == 0 && st.st_size == 0) {
+    if (write(TraceFd, "[\n", 2) != 2) {}
+  }
+  flock(TraceFd, LOCK_UN);
+  return true;
+}
+
+static inline u64
+trace_clock()
+{
+  return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+typedef struct trace_span {
+  const char* name;
+  const char* cat;
+  string args;
+  u64 start;
+
+  trace_span(const char* name, const char* cat, const string& args = "")
+    : name(name), cat(cat), start(0) {
+    if (TraceFd >= 0) {
+      this->args = args;
+      start = trace_clock();
+    }
+  }
+
+  ~trace_span() {
+    if (TraceFd < 0)
+      return;
+    ostringstream so;
+    so << "{\"name\":\"" << name << "\",\"cat\":\"" << cat << "\",\"ph\":\"X\""
+      << ",\"ts\":" << start << ",\"dur\":" << trace_clock() - start
+      << ",\"pid\":" << getpid() << ",\"tid\":" << syscall(SYS_gettid)
+      << ",\"args\":{" << args << "}},\n";
+    auto line = so.str();
+    if (write(TraceFd, line.data(), line.size()) < 0) {}
+  }
+} trace_span;
+
+}
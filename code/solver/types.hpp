@@ -23,138 +23,240 @@ struct vertex_t {
   }
 };
 
-typedef r32 fraction;
-typedef vertex_t<fraction> vertex;
+template <typename T, typename F>
+vector<vertex_t<T>> poly_cast(const vector<vertex_t<F>>& fig) {
+  vector<vertex_t<T>> res;
+  for (auto& v : fig)
+    res.push_back({ (T) v.x, (T) v.y });
+  return res;
+}
 
-typedef vector<vertex> poly;
-typedef vector<poly> polys;
+template <typename F> using poly_t = vector<vertex_t<F>>;
+template <typename F> using polys_t = vector<poly_t<F>>;
+
+// Problems and solutions keep full precision, the search narrows them to
+// the numeric policy it runs with.
+typedef vertex_t<r64> point;
+typedef vector<point> path;
+typedef vector<path> paths;
 typedef vector<u32> vrefs;
 
 typedef struct {
   u32 problem_id;
-  polys outline;
-  poly skeleton;
+  paths outline;
+  path skeleton;
+  u64 denominator;
+  r64 magnitude;
 } problem;
 
 typedef struct {
   u32 problem_id;
-  poly vertices;
+  path vertices;
   vector<vrefs> facets;
-  poly destination;
+  path destination;
 } solution;
 
 
-struct shape;
+template <typename F> struct shape_t;
+
+template <typename F>
+struct edge_t {
+  typedef vertex_t<F> vertex;
 
-typedef struct edge {
   vertex pa;
   vertex pb;
-  shape* owner;
-  shape* neighbor;
+  shape_t<F>* owner;
+  shape_t<F>* neighbor;
 
-  bool operator == (const edge& other) const {
+  bool operator == (const edge_t<F>& other) const {
     return (pa == other.pa && pb == other.pb)
       || (pa == other.pb && pb == other.pa);
   }
-  bool operator != (const edge& other) const {
+  bool operator != (const edge_t<F>& other) const {
     return !(*this == other);
   }
 
   vertex otherEnd(const vertex& v) const { return v == pa ? pb : pa; }
 
-} edge;
+};
 
-typedef struct shape {
-  poly body;
-  poly dest;
+// A facet is a fixed region of the silhouette (source) placed on the sheet
+// by a composed isometry (transform). Sheet coordinates are materialized
+// from the pair only when needed.
+template <typename F>
+struct shape_t {
+  typedef vertex_t<F> vertex;
+  typedef poly_t<F> poly;
+  typedef edge_t<F> edge;
+  typedef shape_t<F> shape;
+
+  shared_ptr<const coords> source;
+  matrix3d transform;
+  coords sheet;
   vector<edge> edges;
 
-  shape() {}
-  ~shape() {}
-  shape(const shape& other);
-  shape(const shape& other, u8 preserveLinks);
-  shape(shape&& other) noexcept;
-  shape& operator = (shape&& other) noexcept;
-  shape& operator = (const shape& other);
-
-  bool operator == (const shape& other) const {
-    return body == other.body;
+  shape_t() : transform(matrix3d::identity()), materialized(false) {}
+  explicit shape_t(const poly& fig);
+  ~shape_t() {}
+  shape_t(const shape_t& other);
+  shape_t(const shape_t& other, u8 preserveLinks);
+  shape_t(shape_t&& other) noexcept;
+  shape_t& operator = (shape_t&& other) noexcept;
+  shape_t& operator = (const shape_t& other);
+
+  bool operator == (const shape_t& other) const {
+    return body() == other.body();
   }
 
-  vector<edge>::reference find(const edge& g);
-  vector<edge>::const_reference find(const edge& g) const;
+  const poly& body() const;
+  poly dest() const;
+
+  void place(const matrix3d& m);
+
+  typename vector<edge>::reference find(const edge& g);
+  typename vector<edge>::const_reference find(const edge& g) const;
 
   u8 isclockwise(const vertex& a, const vertex& b) const;
 
-} shape;
+private:
+  mutable poly cached;
+  mutable u8 materialized;
+
+};
 
-class Graph {
+template <typename F>
+class Graph_t {
+public:
+  typedef vertex_t<F> vertex;
+  typedef poly_t<F> poly;
+  typedef polys_t<F> polys;
+  typedef edge_t<F> edge;
+  typedef shape_t<F> shape;
+  typedef Graph_t<F> Graph;
+
+private:
   vector<shape> shapes;
+
 public:
-  Graph() {}
-  explicit Graph(vector<shape>&& shapes);
-  Graph(const Graph& other);
-  Graph(Graph&& other) noexcept;
-  Graph& operator = (Graph&& other) noexcept;
-  Graph& operator = (const Graph& other);
+  Graph_t() {}
+  explicit Graph_t(vector<shape>&& shapes);
+  Graph_t(const Graph_t& other);
+  Graph_t(const Graph_t& other, size_t capacity);
+  Graph_t(Graph_t&& other) noexcept;
+  Graph_t& operator = (Graph_t&& other) noexcept;
+  Graph_t& operator = (const Graph_t& other);
 
   size_t size() const { return shapes.size(); }
+  const vector<shape>& facets() const { return shapes; }
   poly vertices(u8 destination = false) const;
   poly unique_vertices(u8 destination = false) const;
   const vector<edge> edges() const;
   polys outline() const;
   vector<vrefs> facets_as_indices(const poly& refer) const;
   size_t hashcode() const;
+  size_t bytes() const;
   u8 isempty() const { return shapes.size() == 0; }
+  bbox bounds() const;
 
-  bool operator == (const Graph& other) const {
+  bool operator == (const Graph_t& other) const {
     return shapes == other.shapes;
   }
 
-  shape* at(const Graph& other, const shape* os);
-  const shape* at(const Graph& other, const shape* os) const;
+  shape* at(const Graph_t& other, const shape* os);
+  const shape* at(const Graph_t& other, const shape* os) const;
 
   const vector<edge> edgesAt(const vertex& p) const;
   vector<edge*> edgesAt(const edge& g);
   const vector<shape> facetsOnEdgePoints(const edge& g) const;
   const vector<shape> facetsAt(const vertex& p) const;
+  size_t facetCountAt(const vertex& p, size_t limit) const;
 
-  Graph copy_flip(const edge& g) const;
+  Graph_t copy_flip(const edge& g) const;
+  void link();
 
 };
 
-class Origami {
+template <typename F>
+class Origami_t {
 public:
+  typedef vertex_t<F> vertex;
+  typedef poly_t<F> poly;
+  typedef polys_t<F> polys;
+  typedef edge_t<F> edge;
+  typedef shape_t<F> shape;
+  typedef Graph_t<F> Graph;
+  typedef Origami_t<F> Origami;
+
   Graph graph;
   polys outline;
 
-  Origami() {}
-  explicit Origami(Graph&& other);
+  // Invariants kept alongside the graph: unfold doubles the paper area and
+  // grows the bounds by the mirrored outline, the rest come from outline().
+  r64 area;
+  bbox box;
+  u32 corners;
+  r64 perimeter;
+  r64 outline_area;
 
-  static Origami from(const polys& outline, const poly& skeleton);
+  Origami_t() : area(0), box(bbox::empty()), corners(0), perimeter(0), outline_area(0) {}
+  explicit Origami_t(Graph&& other);
+  Origami_t(Graph&& other, r64 area, const bbox& box);
+
+  static Origami_t from(const paths& outline, const path& skeleton);
+
+  size_t bytes() const;
 
   // origami copy() const;
   u8 isempty() const { return graph.isempty() || outline.size() == 0; }
 
-  bool operator == (const Origami& other) const { return graph == other.graph; }
+  bool operator == (const Origami_t& other) const { return graph == other.graph; }
+
+  bbox unfolded_bounds(const edge& g) const;
+  Origami_t unfold(const edge& g) const;
+  Origami_t unfold(const edge& g, const bbox& box) const;
 
-  Origami unfold(const edge& g) const;
+private:
+  void measure();
 
 };
 
 
-typedef struct search_state {
+template <typename F>
+struct search_state_t {
+  typedef vertex_t<F> vertex;
+  typedef poly_t<F> poly;
+  typedef polys_t<F> polys;
+  typedef edge_t<F> edge;
+  typedef Origami_t<F> Origami;
+  typedef search_state_t<F> search_state;
+
   u8 terminal;
   Origami origami;
+  vector<u8> redundant;
 
-  search_state() : terminal(false) {}
+  search_state_t() : terminal(false) {}
 
   u8 isgoal() const;
   u8 isterminal() const;
   solution get_solution() const;
-  vector<search_state> children() const;
+  vector<edge> unfold_axes() const;
+  void expand(const function<u8(search_state_t&)>& yield) const;
+  vector<search_state_t> children() const;
+
+};
 
-} search_state;
+
+// Single precision is the default policy, and what the tools outside the
+// search work with.
+typedef r32 fraction;
+typedef vertex_t<fraction> vertex;
+typedef poly_t<fraction> poly;
+typedef polys_t<fraction> polys;
+typedef edge_t<fraction> edge;
+typedef shape_t<fraction> shape;
+typedef Graph_t<fraction> Graph;
+typedef Origami_t<fraction> Origami;
+typedef search_state_t<fraction> search_state;
 
 
 template <typename T>
@@ -165,47 +267,29 @@ ostream& operator << (ostream& so, const vertex_t<T>& v) {
 
 template <typename T>
 ostream& operator << (ostream& so, const vector<vertex_t<T>>& p) {
-  so << p.size() << endl;
+  so << p.size() << '\n';
   for (auto v : p)
-    so << v << endl;
+    so << v << '\n';
   return so;
 }
 
 ostream& operator << (ostream& so, const problem& p) {
-  so << p.outline.size() << endl;
+  so << p.outline.size() << '\n';
   for (auto x : p.outline)
     so << x;
   so << p.skeleton;
   return so;
 }
 
-ostream& operator << (ostream& so, const solution& s) {
-  so << s.vertices;
-  so << s.facets.size() << endl;
-  for (auto x : s.facets) {
-    so << x.size();
-    for (auto i : x)
-      so << " " << i;
-    so << endl;
-  }
-  for (auto v : s.destination)
-    so << v << endl;
-
-  return so;
-}
-
-ostream& operator << (ostream& so, const vector<vertex>& s) {
-  so << "{";
-  for (auto& v : s)
-    so << "(" << v.x << "," << v.y << "), ";
-  so << "}";
-  return so;
-}
-
-ostream& operator << (ostream& so, const search_state& s) {
+template <typename F>
+ostream& operator << (ostream& so, const search_state_t<F>& s) {
   so << "outline: ";
-  for (auto& fig : s.origami.outline)
-    so << fig;
+  for (auto& fig : s.origami.outline) {
+    so << "{";
+    for (auto& v : fig)
+      so << "(" << v.x << "," << v.y << "), ";
+    so << "}";
+  }
   return so;
 }
 
@@ -217,12 +301,22 @@ namespace std
   using namespace paiv;
 
   template <>
-  class hash<vertex>
+  class hash<q32>
+  {
+  public:
+    size_t operator() (const q32& a) const
+    {
+      return hash<s64>()(a.raw);
+    }
+  };
+
+  template <typename F>
+  class hash<vertex_t<F>>
   {
   public:
-    size_t operator() (const vertex& a) const
+    size_t operator() (const vertex_t<F>& a) const
     {
-      hash<fraction> h;
+      hash<F> h;
       size_t seed = 0;
       seed ^= h(a.x) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
       seed ^= h(a.y) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
@@ -230,13 +324,13 @@ namespace std
     }
   };
 
-  template <>
-  class hash<poly>
+  template <typename F>
+  class hash<vector<vertex_t<F>>>
   {
   public:
-    size_t operator() (const poly& a) const
+    size_t operator() (const vector<vertex_t<F>>& a) const
     {
-      hash<vertex> h;
+      hash<vertex_t<F>> h;
       size_t seed = 0;
       for (auto v : a) {
         seed ^= h(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
@@ -245,59 +339,59 @@ namespace std
     }
   };
 
-  template <>
-  class hash<shape>
+  template <typename F>
+  class hash<shape_t<F>>
   {
   public:
-    size_t operator() (const shape& a) const
+    size_t operator() (const shape_t<F>& a) const
     {
-      hash<poly> h;
+      hash<poly_t<F>> h;
       size_t seed = 0;
-      seed ^= h(a.body) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+      seed ^= h(a.body()) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
       return seed;
     }
   };
 
-  template <>
-  class hash<Graph>
+  template <typename F>
+  class hash<Graph_t<F>>
   {
   public:
-    size_t operator() (const Graph& a) const
+    size_t operator() (const Graph_t<F>& a) const
     {
       return a.hashcode();
     }
   };
 
-  template <>
-  class hash<Origami>
+  template <typename F>
+  class hash<Origami_t<F>>
   {
   public:
-    size_t operator() (const Origami& a) const
+    size_t operator() (const Origami_t<F>& a) const
     {
-      hash<Graph> h;
+      hash<Graph_t<F>> h;
       size_t seed = 0;
       seed ^= h(a.graph) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
       return seed;
     }
   };
 
-  template <>
-  class hash<search_state>
+  template <typename F>
+  class hash<search_state_t<F>>
   {
   public:
-    size_t operator() (const search_state& a) const
+    size_t operator() (const search_state_t<F>& a) const
     {
-      hash<Origami> h;
+      hash<Origami_t<F>> h;
       size_t seed = 0;
       seed ^= h(a.origami) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
       return seed;
     }
   };
 
-  template <>
-  struct equal_to<search_state>
+  template <typename F>
+  struct equal_to<search_state_t<F>>
   {
-    inline bool operator() (const search_state& a, const search_state& b) const
+    inline bool operator() (const search_state_t<F>& a, const search_state_t<F>& b) const
     {
       return a.origami == b.origami;
     }
@@ -15,4 +15,21 @@ typedef int64_t s64;
 typedef float r32;
 typedef double r64;
 
+
+// Fixed point on the 2^-32 lattice. Values are rounded onto it as they are
+// made, so a point reached along different paths of double arithmetic
+// compares and hashes the same; everything else reads it as r64.
+static const r64 FixedScale = 4294967296.0;
+
+typedef struct q32 {
+  s64 raw;
+
+  q32() : raw(0) {}
+  q32(r64 x) : raw(llround(x * FixedScale)) {}
+  operator r64 () const { return raw / FixedScale; }
+
+  bool operator == (const q32& other) const { return raw == other.raw; }
+  bool operator != (const q32& other) const { return raw != other.raw; }
+} q32;
+
 }
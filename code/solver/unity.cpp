@@ -1,11 +1,31 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <csignal>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <queue>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 using namespace std;
@@ -14,13 +34,24 @@ using namespace std;
 #include "rosetta.cpp"
 #include "linalg.hpp"
 #include "matrix.hpp"
+#include "kernels.hpp"
 #include "types.hpp"
+#include "writer.hpp"
 #include "geometry.hpp"
+#include "stats.cpp"
+#include "trace.cpp"
 
 using namespace paiv;
 
 #include "settings_parser.cpp"
 #include "problem.cpp"
 #include "origami.cpp"
+#include "folds.cpp"
+#include "patterns.cpp"
+#include "validator.cpp"
+#include "classify.cpp"
+#include "checkpoint.cpp"
 #include "solver.cpp"
+#include "decompose.cpp"
 #include "controller.cpp"
+#include "server.cpp"
@@ -0,0 +1,155 @@
+#include "unity.cpp"
+
+// Submitted destinations may sit at huge offsets, far beyond float
+// resolution. The integer part is kept modulo 2^64 with the remainder
+// exact, so differences survive once taken relative to an origin.
+typedef struct wide_fraction {
+  u64 whole;
+  r64 part;
+} wide_fraction;
+
+static wide_fraction
+read_wide_fraction(istream& fin) {
+  string num, den;
+  u8 negative = false;
+
+  fin >> ws;
+  if (fin.peek() == '-' || fin.peek() == '+')
+    negative = fin.get() == '-';
+  while (isdigit(fin.peek()) || fin.peek() == '.'
+    || ((fin.peek() == 'e' || fin.peek() == 'E') && !num.empty()))
+  {
+    num.push_back(fin.get());
+    if ((num.back() == 'e' || num.back() == 'E') && (fin.peek() == '-' || fin.peek() == '+'))
+      num.push_back(fin.get());
+  }
+  if (fin.peek() == '/') {
+    fin.get();
+    while (isdigit(fin.peek()))
+      den.push_back(fin.get());
+  }
+
+  // decimals and huge denominators go through doubles
+  if (den.size() > 18 || num.find_first_not_of("0123456789") != string::npos) {
+    auto x = stod(num.empty() ? "0" : num) / (den.empty() ? 1 : stod(den));
+    auto whole = fabs(x) < 9e18 ? floor(x) : 0;
+    return { (u64) (s64) (negative ? -whole : whole), negative ? -(x - whole) : x - whole };
+  }
+
+  u64 d = den.empty() ? 1 : stoull(den);
+  u64 whole = 0;
+  unsigned __int128 rem = 0;
+  for (auto c : num) {
+    rem = rem * 10 + (c - '0');
+    whole = whole * 10 + (u64) (rem / d);
+    rem %= d;
+  }
+
+  r64 part = d > 0 ? (r64) (u64) rem / d : 0;
+  if (negative)
+    return { 0 - whole, -part };
+  return { whole, part };
+}
+
+// Only distances matter to the rules, so destinations are read relative
+// to the first one, which keeps files placing them at 10^20 or so exact.
+static solution
+read_relative_solution(string& fn)
+{
+  solution s = {};
+
+  ifstream fin(fn, ifstream::binary);
+  read_solution_facets(fin, s);
+
+  wide_fraction origin[2] = {};
+  for (size_t i = 0; i < s.vertices.size(); i++) {
+    char sep;
+    auto x = read_wide_fraction(fin);
+    fin >> sep;
+    auto y = read_wide_fraction(fin);
+    if (i == 0) {
+      origin[0] = x;
+      origin[1] = y;
+    }
+    s.destination.push_back({
+      (r64) (s64) (x.whole - origin[0].whole) + x.part,
+      (r64) (s64) (y.whole - origin[1].whole) + y.part });
+  }
+
+  return s;
+}
+
+typedef struct validate_settings_t
+{
+  list<string> files;
+  bool quiet;
+  bool print_usage_and_exit;
+} validate_settings;
+
+
+static validate_settings
+parse_validate_settings(int argc, char* argv[])
+{
+  int c;
+  int errflg = 0;
+  validate_settings Settings = {};
+
+  while ((c = getopt(argc, argv, "qh")) != -1)
+  {
+    switch (c)
+    {
+      case 'q':
+        Settings.quiet = true;
+        break;
+
+      case '?':
+      case 'h':
+        errflg++;
+        break;
+    }
+  }
+
+  for (int i = optind; i < argc; i++)
+    Settings.files.push_back(argv[i]);
+
+  if (errflg > 0 || Settings.files.size() == 0)
+  {
+    Settings.print_usage_and_exit = true;
+  }
+
+  return Settings;
+}
+
+
+int main(int argc, char* argv[])
+{
+  validate_settings Settings = parse_validate_settings(argc, argv);
+
+  if (Settings.print_usage_and_exit)
+  {
+    cerr << "usage: validate [OPTIONS] FILE...\n"
+      "	-q		Report invalid solutions only\n"
+    << endl;
+    return 2;
+  }
+
+  s32 invalid = 0;
+  for (string fn : Settings.files)
+  {
+    struct stat st;
+    const char* error = "unreadable";
+    if (stat(fn.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+      ifstream fin(fn, ifstream::binary);
+      string text((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+      solution sol = read_relative_solution(fn);
+      error = check_solution(sol, text_size(text));
+    }
+
+    if (error != nullptr)
+      invalid++;
+    if (error != nullptr || !Settings.quiet)
+      cout << fn << "\t" << (error ? error : "ok") << endl;
+  }
+
+  return invalid > 0 ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+
+namespace paiv {
+
+// Checks a solution against the contest rules before it leaves the solver.
+// Returns nullptr for a valid solution, otherwise what is wrong with it.
+//
+// Coordinates are rounded output, so every test allows for it; facets
+// partition the square when they stay inside it, do not overlap and their
+// areas add up to one.
+
+static const r64 ValidationTolerance = 0.0001;
+static const size_t MaxSolutionSize = 5000;
+
+// Solution size as the contest counts it, whitespace excluded.
+static size_t
+text_size(const string& text)
+{
+  return count_if(begin(text), end(text), [] (char c) { return !isspace((unsigned char) c); });
+}
+
+static size_t
+solution_size(const solution& s)
+{
+  text_buffer out;
+  format_solution(out, s);
+  return text_size(out.data);
+}
+
+
+static r64
+side(const point& a, const point& b, const point& p)
+{
+  return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+static u8
+crosses(const point& a, const point& b, const point& c, const point& d)
+{
+  auto s1 = side(a, b, c), s2 = side(a, b, d);
+  auto s3 = side(c, d, a), s4 = side(c, d, b);
+  auto eps = ValidationTolerance * ValidationTolerance;
+  return ((s1 > eps && s2 < -eps) || (s1 < -eps && s2 > eps))
+    && ((s3 > eps && s4 < -eps) || (s3 < -eps && s4 > eps));
+}
+
+static r64
+segment_distance2(const point& a, const point& b, const point& p)
+{
+  r64 dx = b.x - a.x, dy = b.y - a.y;
+  r64 len = dx * dx + dy * dy;
+  r64 t = len > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len : 0;
+  t = fmax(0, fmin(1, t));
+  r64 x = a.x + t * dx - p.x, y = a.y + t * dy - p.y;
+  return x * x + y * y;
+}
+
+// Inside and clear of the boundary by more than the tolerance.
+static u8
+strictly_inside(const path& fig, const point& p)
+{
+  u8 inside = false;
+  for (size_t i = 0, j = fig.size() - 1; i < fig.size(); j = i++) {
+    auto& a = fig[i];
+    auto& b = fig[j];
+    if (segment_distance2(a, b, p) < ValidationTolerance * ValidationTolerance)
+      return false;
+    if ((a.y > p.y) != (b.y > p.y)
+      && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+      inside = !inside;
+  }
+  return inside;
+}
+
+static u8
+overlap(const path& a, const path& b)
+{
+  for (size_t i = 0; i < a.size(); i++)
+    for (size_t j = 0; j < b.size(); j++)
+      if (crosses(a[i], a[(i + 1) % a.size()], b[j], b[(j + 1) % b.size()]))
+        return true;
+
+  auto probe = [] (const path& fig, const path& other) {
+    r64 x = 0, y = 0;
+    for (auto& v : fig) {
+      if (strictly_inside(other, v))
+        return true;
+      x += v.x;
+      y += v.y;
+    }
+    // the vertex mean is an interior point of convex facets, it catches
+    // facets stacked exactly on top of each other
+    point c = { x / fig.size(), y / fig.size() };
+    return strictly_inside(fig, c) && strictly_inside(other, c);
+  };
+  return probe(a, b) || probe(b, a);
+}
+
+
+static const char*
+check_solution(const solution& s, size_t size)
+{
+  auto n = s.vertices.size();
+  if (n < 3 || s.facets.size() == 0)
+    return "empty";
+  if (s.destination.size() != n)
+    return "destination count";
+  if (size > MaxSolutionSize)
+    return "size limit";
+
+  vector<u8> used(n);
+  vector<path> sources;
+  for (auto& refs : s.facets) {
+    if (refs.size() < 3)
+      return "degenerate facet";
+    path fig;
+    for (auto i : refs) {
+      if (i >= n)
+        return "vertex index";
+      if (used[i] == 2)
+        return "repeated facet vertex";
+      used[i] = 2;
+      fig.push_back(s.vertices[i]);
+    }
+    for (auto i : refs)
+      used[i] = 1;
+    sources.push_back(fig);
+  }
+  if (find(begin(used), end(used), 0) != end(used))
+    return "unused vertex";
+
+  for (size_t i = 0; i < n; i++) {
+    auto& v = s.vertices[i];
+    if (v.x < -ValidationTolerance || v.x > 1 + ValidationTolerance
+      || v.y < -ValidationTolerance || v.y > 1 + ValidationTolerance)
+      return "vertex outside square";
+    for (size_t j = i + 1; j < n; j++)
+      if (distance2(v, s.vertices[j]) < ValidationTolerance * ValidationTolerance)
+        return "coincident vertices";
+  }
+
+  r64 total = 0;
+  for (size_t k = 0; k < sources.size(); k++) {
+    auto a = area(sources[k]);
+    if (a < ValidationTolerance * ValidationTolerance)
+      return "degenerate facet";
+    total += a;
+
+    // equal pairwise distances make the map an isometry, mirror included
+    auto& refs = s.facets[k];
+    for (size_t i = 0; i < refs.size(); i++)
+      for (size_t j = i + 1; j < refs.size(); j++) {
+        auto d1 = sqrt(distance2(s.vertices[refs[i]], s.vertices[refs[j]]));
+        auto d2 = sqrt(distance2(s.destination[refs[i]], s.destination[refs[j]]));
+        if (!near(d1, d2, ValidationTolerance))
+          return "facet not congruent";
+      }
+  }
+  if (!near(total, 1, ValidationTolerance))
+    return "facets do not cover square";
+
+  for (size_t i = 0; i < sources.size(); i++)
+    for (size_t j = i + 1; j < sources.size(); j++)
+      if (overlap(sources[i], sources[j]))
+        return "facets overlap";
+
+  return nullptr;
+}
+
+static const char*
+check_solution(const solution& s)
+{
+  return check_solution(s, solution_size(s));
+}
+
+}
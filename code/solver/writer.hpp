@@ -0,0 +1,148 @@
+#pragma once
+
+namespace paiv {
+
+// Solutions go out in one write each. Numbers go through to_chars, which
+// ignores the locale and gives the shortest text that reads back as the
+// same double, so no digits are lost on the way to postproc.
+
+typedef struct text_buffer {
+  string data;
+
+  void put(char c) { data.push_back(c); }
+
+  void real(r64 x) {
+    char tmp[32];
+    auto r = to_chars(tmp, tmp + sizeof(tmp), x);
+    data.append(tmp, r.ptr - tmp);
+  }
+
+  void integer(u64 x) {
+    char tmp[24];
+    auto r = to_chars(tmp, tmp + sizeof(tmp), x);
+    data.append(tmp, r.ptr - tmp);
+  }
+
+  void point(const vertex_t<r64>& v) {
+    real(v.x);
+    put(',');
+    real(v.y);
+    put('\n');
+  }
+} text_buffer;
+
+static void
+format_solution(text_buffer& out, const solution& s)
+{
+  out.integer(s.vertices.size());
+  out.put('\n');
+  for (auto& v : s.vertices)
+    out.point(v);
+  out.integer(s.facets.size());
+  out.put('\n');
+  for (auto& refs : s.facets) {
+    out.integer(refs.size());
+    for (auto i : refs) {
+      out.put(' ');
+      out.integer(i);
+    }
+    out.put('\n');
+  }
+  for (auto& v : s.destination)
+    out.point(v);
+}
+
+ostream& operator << (ostream& so, const solution& s) {
+  text_buffer out;
+  format_solution(out, s);
+  so.write(out.data.data(), out.data.size());
+  return so;
+}
+
+
+// Binary results, for keeping many candidate solutions around; convert
+// turns them back into the contest format. A file is a run of records:
+//
+//   header    magic "SOL1", problem id, vertex, facet and index counts
+//   body      r64 source x,y pairs, u32 facet sizes, u32 vertex indices,
+//             r64 destination x,y pairs
+//
+// Host byte order, like the pattern database.
+
+typedef struct result_header {
+  char magic[4];
+  u32 problem_id;
+  u32 vertices;
+  u32 facets;
+  u32 indices;
+} result_header;
+
+static const char ResultMagic[4] = { 'S', 'O', 'L', '1' };
+
+static void
+format_result(string& out, const solution& s)
+{
+  result_header header = {};
+  copy(begin(ResultMagic), end(ResultMagic), header.magic);
+  header.problem_id = s.problem_id;
+  header.vertices = s.vertices.size();
+  header.facets = s.facets.size();
+  for (auto& refs : s.facets)
+    header.indices += refs.size();
+
+  out.append((const char*) &header, sizeof(header));
+  for (auto& v : s.vertices) {
+    out.append((const char*) &v.x, sizeof(r64));
+    out.append((const char*) &v.y, sizeof(r64));
+  }
+  for (auto& refs : s.facets) {
+    u32 n = refs.size();
+    out.append((const char*) &n, sizeof(n));
+  }
+  for (auto& refs : s.facets)
+    out.append((const char*) refs.data(), refs.size() * sizeof(u32));
+  for (auto& v : s.destination) {
+    out.append((const char*) &v.x, sizeof(r64));
+    out.append((const char*) &v.y, sizeof(r64));
+  }
+}
+
+// False at the end of the stream or on a damaged record.
+static u8
+read_result(istream& in, solution& s)
+{
+  result_header header;
+  if (!in.read((char*) &header, sizeof(header))
+    || !equal(begin(ResultMagic), end(ResultMagic), header.magic))
+    return false;
+
+  auto points = [&in] (path& res, size_t n) {
+    vector<r64> xy(2 * n);
+    if (!in.read((char*) xy.data(), xy.size() * sizeof(r64)))
+      return false;
+    res.clear();
+    for (size_t i = 0; i < n; i++)
+      res.push_back({ xy[2 * i], xy[2 * i + 1] });
+    return true;
+  };
+
+  s = { header.problem_id };
+  vector<u32> sizes(header.facets);
+  vrefs indices(header.indices);
+  if (!points(s.vertices, header.vertices)
+    || !in.read((char*) sizes.data(), sizes.size() * sizeof(u32))
+    || !in.read((char*) indices.data(), indices.size() * sizeof(u32))
+    || !points(s.destination, header.vertices))
+    return false;
+
+  size_t at = 0;
+  for (auto n : sizes) {
+    if (n > indices.size() - at)
+      return false;
+    s.facets.emplace_back(begin(indices) + at, begin(indices) + at + n);
+    at += n;
+  }
+  return at == indices.size();
+}
+
+}